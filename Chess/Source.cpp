@@ -1,5 +1,8 @@
 #define OLC_PGE_APPLICATION
 #include "olcPixelGameEngine.h"
+#include "olcUtility.h"
+
+#include <random>
 
 
 #define WPWN new Piece(PieceType::PAWN, PieceColor::WHITE, PieceLogic(PieceType::PAWN))
@@ -48,60 +51,6 @@ Source	https://commons.wikimedia.org/wiki/File:Chess_Board.svg
 Author	Nevit Dilmen
 */
 
-namespace ASSETS {
-	struct sheet {
-		std::string path;
-		olc::vi2d rowColumn, spriteSize;
-		std::vector<std::vector<olc::Decal*>> decals;
-
-		sheet(std::string _path, olc::vi2d _spriteSize, olc::vi2d _rowColumn, bool _flipRowColumn = false) {
-			path = _path;
-			spriteSize = _spriteSize;
-
-			if (_flipRowColumn) {
-				rowColumn.x = _rowColumn.y;
-				rowColumn.y = _rowColumn.x;
-			}
-			else
-				rowColumn = _rowColumn;
-		}
-
-		void loadAsset(olc::PixelGameEngine* pge) {
-			// Load and process sheet
-			olc::Sprite* sheet = new olc::Sprite(path);
-			olc::Sprite* screen = pge->GetDrawTarget();
-
-			for (int i = 0; i < rowColumn.x; i++)
-			{
-				decals.push_back(std::vector<olc::Decal*>());
-				for (int k = 0; k < rowColumn.y; k++)
-				{
-					olc::Sprite* buffer = new olc::Sprite(spriteSize.x, spriteSize.y);
-					pge->SetDrawTarget(buffer);
-
-					pge->DrawPartialSprite({ 0,0 }, sheet, olc::vi2d{ spriteSize.x * i, spriteSize.y * k }, spriteSize);
-					decals[i].push_back(new olc::Decal(buffer));
-				}
-			}
-
-			pge->SetDrawTarget(screen);
-		}
-	};
-	
-	struct asset {
-		std::string path;
-		olc::vi2d spriteSize;
-		olc::Decal* decal;
-
-		asset(std::string _path, olc::vi2d _spriteSize) : path(_path), spriteSize(_spriteSize), decal( nullptr ){}
-
-		void loadAsset(olc::PixelGameEngine* pge)
-		{
-			decal = new olc::Decal(new olc::Sprite(path));
-		}
-	};
-}
-
 namespace Game {
 	
 	template <class T>
@@ -749,7 +698,7 @@ public:
 		}
 
 		void drawSelf(Chess* pge) {
-			pge->DrawDecal(pos * 64, pge->chessPieceSheet.decals[(int)eType][(int)eColor]);
+			pge->chessPieceSheet.draw(pge, pos * 64, (int)eType, (int)eColor);
 
 			if (displayMoves)
 			{
@@ -769,12 +718,18 @@ public:
 				// Shortcut, if the end position is equal to the selected position
 				if (m.endPos == tryPos)
 				{
+					// Captures and pawn moves can never be undone, so repetitions cannot reach past them
+					bool irreversible = eType == PieceType::PAWN;
+
 					// If there is a second piece effected
 					if (m.secondaryPiece)
 					{
 						// If the move is an attack move, delete the piece in question
 						if (m.eType != MoveType::CASTLE)
+						{
 							board->deletePieceAt(m.secondaryPiece->pos);
+							irreversible = true;
+						}
 					}
 
 					// No longer first move
@@ -786,6 +741,7 @@ public:
 					// Move to new location on the board and internally
 					board->movePiece(pos, tryPos);
 					pos = tryPos;
+					board->recordMove(irreversible, m.eType == MoveType::DOUBLE_MOVE ? tryPos.x : -1);
 
 					// Update logic based on new position
 					board->updateAllLogic();
@@ -804,6 +760,7 @@ public:
 					// Move to new location on the board and internally
 					board->movePiece(pos, tryPos);
 					pos = tryPos;
+					board->recordMove(eType == PieceType::PAWN);
 
 					// Update logic based on new position
 					board->updateAllLogic();
@@ -844,7 +801,59 @@ public:
 
 		kingState whiteKing, blackKing;
 
+		// Zobrist key of the current position, and the key of every position reached this game (current one last)
+		uint64_t hash;
+		std::vector<uint64_t> hashHistory;
+		// Index in hashHistory of the position reached by the last capture or pawn move
+		int lastIrreversible;
+		// Castling rights hashed into the key, a bit each for white and black on the king and queen side, and the
+		// file a pawn just double moved on (-1 for none)
+		int castlingRights;
+		int enPassantFile;
+
 	private:
+		// One random key per piece type, color and square, one for black to move, one per castling right and one
+		// per en passant file
+		static uint64_t zobristKey(int index)
+		{
+			static std::vector<uint64_t> keys = [] {
+				std::mt19937_64 rng(0x43686573735A6F62ull);
+				std::vector<uint64_t> k(6 * 2 * 64 + 1 + 4 + 8);
+				for (uint64_t& key : k) key = rng();
+				return k;
+			}();
+
+			return keys[index];
+		}
+
+		static uint64_t zobristKey(Piece* p, olc::vi2d pos) { return zobristKey(((int)p->eType * 2 + (int)p->eColor) * 64 + vtoi(pos)); }
+		static uint64_t zobristSideKey() { return zobristKey(6 * 2 * 64); }
+		static uint64_t zobristCastlingKey(int right) { return zobristKey(6 * 2 * 64 + 1 + right); }
+		static uint64_t zobristEnPassantKey(int file) { return zobristKey(6 * 2 * 64 + 1 + 4 + file); }
+
+		// Whether the piece on a square is the given one and has not moved yet
+		bool unmoved(olc::vi2d pos, PieceType type, PieceColor color)
+		{
+			Piece* p = getPieceAt(pos);
+			return p && p->eType == type && p->eColor == color && p->logic.firstMove;
+		}
+
+		// A right stays while the king and that rook are both unmoved
+		int findCastlingRights()
+		{
+			int rights = 0;
+			if (unmoved({ 4, 7 }, PieceType::KING, PieceColor::WHITE))
+			{
+				if (unmoved({ 7, 7 }, PieceType::ROOK, PieceColor::WHITE)) rights |= 1;
+				if (unmoved({ 0, 7 }, PieceType::ROOK, PieceColor::WHITE)) rights |= 2;
+			}
+			if (unmoved({ 4, 0 }, PieceType::KING, PieceColor::BLACK))
+			{
+				if (unmoved({ 7, 0 }, PieceType::ROOK, PieceColor::BLACK)) rights |= 4;
+				if (unmoved({ 0, 0 }, PieceType::ROOK, PieceColor::BLACK)) rights |= 8;
+			}
+			return rights;
+		}
 
 	public:
 		GameBoard()
@@ -852,11 +861,24 @@ public:
 			board = defaultBoard;
 			isPieceSelected = false;
 			eColor = PieceColor::WHITE;
+			turn = 0;
+			hash = 0;
 
 			for(int i = 0; i < 8; i++)
 				for (int k = 0; k < 8; k++)
-					if(board[vtoi({ k, i })])
+					if (board[vtoi({ k, i })])
+					{
 						board[vtoi({ k, i })]->pos = { k, i };
+						hash ^= zobristKey(board[vtoi({ k, i })], { k, i });
+					}
+
+			castlingRights = findCastlingRights();
+			for (int right = 0; right < 4; right++)
+				if (castlingRights & (1 << right)) hash ^= zobristCastlingKey(right);
+			enPassantFile = -1;
+
+			hashHistory.push_back(hash);
+			lastIrreversible = 0;
 
 			whiteKing.ptr = board[vtoi({ 4, 7 })];
 			blackKing.ptr = board[vtoi({ 4, 0 })];
@@ -875,8 +897,56 @@ public:
 		bool isPieceAt(olc::vi2d pos) { return board[vtoi(pos)]; }
 		bool isPieceAt(olc::vi2d pos, PieceColor color) { return board[vtoi(pos)]->eColor == color; }
 
-		void deletePieceAt(olc::vi2d pos) { if(boundedInMap(pos)) board[vtoi(pos)] = nullptr; }
-		void movePiece(olc::vi2d from, olc::vi2d to) { if (getPieceAt(from) && !getPieceAt(to)) { board[vtoi(to)] = getPieceAt(from); deletePieceAt(from); } }
+		void deletePieceAt(olc::vi2d pos) { if (getPieceAt(pos)) { hash ^= zobristKey(board[vtoi(pos)], pos); board[vtoi(pos)] = nullptr; } }
+		void movePiece(olc::vi2d from, olc::vi2d to)
+		{
+			if (getPieceAt(from) && !getPieceAt(to))
+			{
+				hash ^= zobristKey(getPieceAt(from), to);
+				board[vtoi(to)] = getPieceAt(from);
+				hash ^= zobristKey(board[vtoi(from)], from);
+				board[vtoi(from)] = nullptr;
+			}
+		}
+
+		// Push the position a move just produced, the side to move changes with every move. doubleMoveFile is the
+		// file of a pawn that just double moved, which can be taken en passant on the next move only.
+		void recordMove(bool irreversible, int doubleMoveFile = -1)
+		{
+			hash ^= zobristSideKey();
+
+			// Castling rights are only ever lost
+			int rights = findCastlingRights();
+			for (int right = 0; right < 4; right++)
+				if ((castlingRights ^ rights) & (1 << right)) hash ^= zobristCastlingKey(right);
+			castlingRights = rights;
+
+			if (enPassantFile >= 0) hash ^= zobristEnPassantKey(enPassantFile);
+			enPassantFile = doubleMoveFile;
+			if (enPassantFile >= 0) hash ^= zobristEnPassantKey(enPassantFile);
+			hashHistory.push_back(hash);
+
+			if (irreversible)
+				lastIrreversible = (int)hashHistory.size() - 1;
+		}
+
+		// Number of earlier times the current position was reached, only positions since the last
+		// irreversible move with the same side to move (every second ply) can match
+		int repetitionCount()
+		{
+			int count = 0;
+
+			for (int i = (int)hashHistory.size() - 3; i >= lastIrreversible; i -= 2)
+				if (hashHistory[i] == hash)
+					count++;
+
+			return count;
+		}
+
+		bool isRepetition(int times = 3) { return repetitionCount() + 1 >= times; }
+
+		// Fifty moves by each player (100 plies) without a capture or pawn move
+		bool isFiftyMoveDraw() { return (int)hashHistory.size() - 1 - lastIrreversible >= 100; }
 		void updateAllLogic()
 		{
 			whiteKing.fillKingMap();
@@ -1033,6 +1103,10 @@ public:
 					{
 						turn++;
 						eColor = eColor == PieceColor::WHITE ? PieceColor::BLACK : PieceColor::WHITE;
+
+						if (isRepetition()) Log("DRAW BY THREEFOLD REPETITION!");
+						else if (isFiftyMoveDraw()) Log("DRAW BY FIFTY-MOVE RULE!");
+
 						return;
 					}
 
@@ -1065,8 +1139,8 @@ public:
 
 	bool OnUserCreate() override
 	{
-		chessPieceSheet.loadAsset(this);
-		chessBoardPNG.loadAsset(this);
+		chessPieceSheet.loadAsset();
+		chessBoardPNG.loadAsset();
 
 		//Debug::DebugPieceLogic |= Debug::Pawn;
 
@@ -1077,7 +1151,10 @@ public:
 
 	bool OnUserUpdate(float fElapsedTime) override
 	{
-		DrawDecal({ 0,0 }, chessBoardPNG.decal, {0.81f, 0.81f}, olc::Pixel(220, 220, 220));
+		// Finish any sprites decoded in the background, placeholders draw until then
+		util::AssetCache::get().update();
+
+		chessBoardPNG.draw(this, { 0,0 }, {0.81f, 0.81f}, olc::Pixel(220, 220, 220));
 		board.drawBoard(this);
 
 		return true;
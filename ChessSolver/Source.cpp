@@ -0,0 +1,716 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+
+/*
+MATE-IN-N SOLVER
+Proves forced mates with depth-first proof-number search (df-pn). The board logic follows the Chess
+project's conventions: the same PieceType numbering, squares counted from the top left (a8) and the same
+Zobrist keys as GameBoard, but positions are small value types so search threads can copy-make them freely.
+
+Usage:
+	ChessSolver [-threads T] [-memory MB] [-nodes BUDGET] [-all] "<FEN>" N
+	ChessSolver [-threads T] [-memory MB] [-nodes BUDGET] [-all] -batch <file>
+
+Each line of a batch file is "<FEN> ; N". Blank lines and lines starting with # are skipped.
+*/
+
+namespace Solver {
+
+	enum class PieceType {
+		PAWN	= 5,
+		BISHOP	= 4,
+		KNIGHT	= 3,
+		ROOK	= 2,
+		KING	= 1,
+		QUEEN	= 0
+	};
+
+	enum class PieceColor {
+		WHITE = 0,
+		BLACK = 1
+	};
+
+	// Cell contents, PieceType * 2 + PieceColor, the same index the Zobrist table uses
+	typedef int8_t Cell;
+	const Cell EMPTY = -1;
+
+	inline Cell makeCell(PieceType type, PieceColor color) { return (Cell)((int)type * 2 + (int)color); }
+	inline PieceType cellType(Cell c) { return (PieceType)(c >> 1); }
+	inline int cellColor(Cell c) { return c & 1; }
+
+	// 0x88 board, row 0 is rank 8 so the layout matches the Chess board's { x, y } positions
+	inline bool onBoard(int sq) { return !(sq & 0x88); }
+	inline int toIndex64(int sq) { return (sq >> 4) * 8 + (sq & 7); }
+
+	const int NO_SQUARE = -1;
+
+	// Castling rights
+	const int WHITE_SHORT = 1, WHITE_LONG = 2, BLACK_SHORT = 4, BLACK_LONG = 8;
+
+	const int knightSteps[8] = { -33, -31, -18, -14, 14, 18, 31, 33 };
+	const int kingSteps[8] = { -17, -16, -15, -1, 1, 15, 16, 17 };
+	const int bishopSteps[4] = { -17, -15, 15, 17 };
+	const int rookSteps[4] = { -16, -1, 1, 16 };
+
+	// Same seed and layout as GameBoard's keys: pieces, black to move, a key per castling right and per en passant
+	// file, then the depth keys only the solver uses
+	const int KEY_SIDE = 6 * 2 * 64;
+	const int KEY_CASTLE = KEY_SIDE + 1;
+	const int KEY_EP = KEY_CASTLE + 4;
+	const int KEY_DEPTH = KEY_EP + 8;
+	const int MAX_DEPTH = 64;
+
+	uint64_t zobristKey(int index)
+	{
+		static std::vector<uint64_t> keys = [] {
+			std::mt19937_64 rng(0x43686573735A6F62ull);
+			std::vector<uint64_t> k(KEY_DEPTH + MAX_DEPTH + 1);
+			for (uint64_t& key : k) key = rng();
+			return k;
+		}();
+
+		return keys[index];
+	}
+
+	// Keys of every castling right held, each right hashed on its own as GameBoard does
+	uint64_t castlingKey(int rights)
+	{
+		uint64_t key = 0;
+		for (int right = 0; right < 4; right++)
+			if (rights & (1 << right)) key ^= zobristKey(KEY_CASTLE + right);
+		return key;
+	}
+
+	struct Move {
+		uint8_t from = 0, to = 0;
+		Cell promotion = EMPTY;
+
+		std::string str() const
+		{
+			std::string s;
+			s += char('a' + (from & 7)); s += char('8' - (from >> 4));
+			s += char('a' + (to & 7)); s += char('8' - (to >> 4));
+			if (promotion != EMPTY) s += "qkrnbp"[(int)cellType(promotion)];
+			return s;
+		}
+	};
+
+	struct Position {
+		Cell cell[128];
+		int side = 0;
+		int castling = 0;
+		int epSquare = NO_SQUARE;
+		int kingSq[2] = { NO_SQUARE, NO_SQUARE };
+		uint64_t hash = 0;
+
+		Position() { std::memset(cell, EMPTY, sizeof(cell)); }
+
+		void computeHash()
+		{
+			hash = 0;
+			for (int sq = 0; sq < 128; sq++)
+				if (onBoard(sq) && cell[sq] != EMPTY)
+					hash ^= zobristKey(cell[sq] * 64 + toIndex64(sq));
+
+			if (side) hash ^= zobristKey(KEY_SIDE);
+			hash ^= castlingKey(castling);
+			if (epSquare != NO_SQUARE) hash ^= zobristKey(KEY_EP + (epSquare & 7));
+		}
+
+		bool loadFEN(const std::string& fen)
+		{
+			std::istringstream in(fen);
+			std::string placement, sideStr, castleStr = "-", epStr = "-";
+			if (!(in >> placement >> sideStr)) return false;
+			in >> castleStr >> epStr;
+
+			std::memset(cell, EMPTY, sizeof(cell));
+			int row = 0, col = 0;
+			for (char c : placement)
+			{
+				if (c == '/') { row++; col = 0; continue; }
+				if (c >= '1' && c <= '8') { col += c - '0'; continue; }
+
+				const char* types = "qkrnbp";
+				const char* found = std::strchr(types, std::tolower(c));
+				if (!found || row > 7 || col > 7) return false;
+
+				PieceColor color = std::isupper(c) ? PieceColor::WHITE : PieceColor::BLACK;
+				cell[row * 16 + col] = makeCell((PieceType)(found - types), color);
+				if (found - types == (int)PieceType::KING) kingSq[(int)color] = row * 16 + col;
+				col++;
+			}
+
+			side = sideStr == "b";
+			castling = 0;
+			for (char c : castleStr)
+				castling |= c == 'K' ? WHITE_SHORT : c == 'Q' ? WHITE_LONG : c == 'k' ? BLACK_SHORT : c == 'q' ? BLACK_LONG : 0;
+			epSquare = epStr.size() == 2 ? ('8' - epStr[1]) * 16 + (epStr[0] - 'a') : NO_SQUARE;
+
+			computeHash();
+			return kingSq[0] != NO_SQUARE && kingSq[1] != NO_SQUARE;
+		}
+
+		bool isAttacked(int sq, int byColor) const
+		{
+			// Pawns attack towards the opposite side's home row
+			int pawnRow = byColor == (int)PieceColor::WHITE ? 16 : -16;
+			for (int dx : { -1, 1 })
+			{
+				int from = sq + pawnRow + dx;
+				if (onBoard(from) && cell[from] == makeCell(PieceType::PAWN, (PieceColor)byColor)) return true;
+			}
+
+			for (int step : knightSteps)
+				if (onBoard(sq + step) && cell[sq + step] == makeCell(PieceType::KNIGHT, (PieceColor)byColor)) return true;
+
+			for (int step : kingSteps)
+				if (onBoard(sq + step) && cell[sq + step] == makeCell(PieceType::KING, (PieceColor)byColor)) return true;
+
+			for (int step : bishopSteps)
+				for (int to = sq + step; onBoard(to); to += step)
+				{
+					if (cell[to] == EMPTY) continue;
+					if (cell[to] == makeCell(PieceType::BISHOP, (PieceColor)byColor) || cell[to] == makeCell(PieceType::QUEEN, (PieceColor)byColor)) return true;
+					break;
+				}
+
+			for (int step : rookSteps)
+				for (int to = sq + step; onBoard(to); to += step)
+				{
+					if (cell[to] == EMPTY) continue;
+					if (cell[to] == makeCell(PieceType::ROOK, (PieceColor)byColor) || cell[to] == makeCell(PieceType::QUEEN, (PieceColor)byColor)) return true;
+					break;
+				}
+
+			return false;
+		}
+
+		bool inCheck() const { return isAttacked(kingSq[side], side ^ 1); }
+
+		void setCell(int sq, Cell c)
+		{
+			if (cell[sq] != EMPTY) hash ^= zobristKey(cell[sq] * 64 + toIndex64(sq));
+			cell[sq] = c;
+			if (c != EMPTY) hash ^= zobristKey(c * 64 + toIndex64(sq));
+		}
+
+		// Copy-make, returns false if the move leaves the mover's king in check
+		bool makeMove(const Move& m, Position& out) const
+		{
+			out = *this;
+			Cell moving = cell[m.from];
+			PieceType type = cellType(moving);
+
+			if (out.epSquare != NO_SQUARE) out.hash ^= zobristKey(KEY_EP + (out.epSquare & 7));
+			out.epSquare = NO_SQUARE;
+
+			// En passant removes the pawn beside the target square
+			if (type == PieceType::PAWN && m.to == epSquare)
+				out.setCell(m.to + (side == (int)PieceColor::WHITE ? 16 : -16), EMPTY);
+
+			// Castling also moves the rook
+			if (type == PieceType::KING && std::abs(m.to - m.from) == 2)
+			{
+				int rookFrom = m.to > m.from ? m.from + 3 : m.from - 4, rookTo = (m.from + m.to) / 2;
+				out.setCell(rookTo, cell[rookFrom]);
+				out.setCell(rookFrom, EMPTY);
+			}
+
+			out.setCell(m.to, m.promotion != EMPTY ? m.promotion : moving);
+			out.setCell(m.from, EMPTY);
+
+			if (type == PieceType::KING) out.kingSq[side] = m.to;
+			if (type == PieceType::PAWN && std::abs(m.to - m.from) == 32)
+			{
+				out.epSquare = (m.from + m.to) / 2;
+				out.hash ^= zobristKey(KEY_EP + (out.epSquare & 7));
+			}
+
+			int rights = out.castling & castleRights(m.from) & castleRights(m.to);
+			out.hash ^= castlingKey(out.castling ^ rights);
+			out.castling = rights;
+
+			out.side ^= 1;
+			out.hash ^= zobristKey(KEY_SIDE);
+
+			return !out.isAttacked(out.kingSq[side], out.side);
+		}
+
+		static int castleRights(int sq)
+		{
+			switch (sq)
+			{
+			case 0x74: return 15 & ~(WHITE_SHORT | WHITE_LONG);
+			case 0x77: return 15 & ~WHITE_SHORT;
+			case 0x70: return 15 & ~WHITE_LONG;
+			case 0x04: return 15 & ~(BLACK_SHORT | BLACK_LONG);
+			case 0x07: return 15 & ~BLACK_SHORT;
+			case 0x00: return 15 & ~BLACK_LONG;
+			default: return 15;
+			}
+		}
+
+		void addPawnMove(std::vector<Move>& moves, int from, int to) const
+		{
+			Move m; m.from = (uint8_t)from; m.to = (uint8_t)to;
+
+			if ((to >> 4) == 0 || (to >> 4) == 7)
+			{
+				for (PieceType promo : { PieceType::QUEEN, PieceType::KNIGHT, PieceType::ROOK, PieceType::BISHOP })
+				{
+					m.promotion = makeCell(promo, (PieceColor)side);
+					moves.push_back(m);
+				}
+			}
+			else
+				moves.push_back(m);
+		}
+
+		// Pseudo-legal moves, makeMove rejects the ones that leave the king in check
+		void generateMoves(std::vector<Move>& moves) const
+		{
+			moves.clear();
+			int forward = side == (int)PieceColor::WHITE ? -16 : 16;
+			int startRow = side == (int)PieceColor::WHITE ? 6 : 1;
+
+			for (int from = 0; from < 128; from++)
+			{
+				if (!onBoard(from) || cell[from] == EMPTY || cellColor(cell[from]) != side)
+					continue;
+
+				auto addStep = [&](int to) {
+					if (!onBoard(to) || (cell[to] != EMPTY && cellColor(cell[to]) == side)) return false;
+					Move m; m.from = (uint8_t)from; m.to = (uint8_t)to;
+					moves.push_back(m);
+					return cell[to] == EMPTY;
+				};
+
+				switch (cellType(cell[from]))
+				{
+				case PieceType::PAWN:
+					if (onBoard(from + forward) && cell[from + forward] == EMPTY)
+					{
+						addPawnMove(moves, from, from + forward);
+						if ((from >> 4) == startRow && cell[from + 2 * forward] == EMPTY)
+							addPawnMove(moves, from, from + 2 * forward);
+					}
+					for (int dx : { -1, 1 })
+					{
+						int to = from + forward + dx;
+						if (onBoard(to) && ((cell[to] != EMPTY && cellColor(cell[to]) != side) || to == epSquare))
+							addPawnMove(moves, from, to);
+					}
+					break;
+				case PieceType::KNIGHT:
+					for (int step : knightSteps) addStep(from + step);
+					break;
+				case PieceType::BISHOP:
+					for (int step : bishopSteps) for (int to = from + step; addStep(to); to += step);
+					break;
+				case PieceType::ROOK:
+					for (int step : rookSteps) for (int to = from + step; addStep(to); to += step);
+					break;
+				case PieceType::QUEEN:
+					for (int step : bishopSteps) for (int to = from + step; addStep(to); to += step);
+					for (int step : rookSteps) for (int to = from + step; addStep(to); to += step);
+					break;
+				case PieceType::KING:
+					for (int step : kingSteps) addStep(from + step);
+
+					// Castling, the king may not start in, pass through or land in check
+					{
+						int shortRight = side == (int)PieceColor::WHITE ? WHITE_SHORT : BLACK_SHORT;
+						int longRight = side == (int)PieceColor::WHITE ? WHITE_LONG : BLACK_LONG;
+						int enemy = side ^ 1;
+
+						if ((castling & shortRight) && cell[from + 1] == EMPTY && cell[from + 2] == EMPTY &&
+							!isAttacked(from, enemy) && !isAttacked(from + 1, enemy))
+						{
+							Move m; m.from = (uint8_t)from; m.to = (uint8_t)(from + 2);
+							moves.push_back(m);
+						}
+
+						if ((castling & longRight) && cell[from - 1] == EMPTY && cell[from - 2] == EMPTY && cell[from - 3] == EMPTY &&
+							!isAttacked(from, enemy) && !isAttacked(from - 1, enemy))
+						{
+							Move m; m.from = (uint8_t)from; m.to = (uint8_t)(from - 2);
+							moves.push_back(m);
+						}
+					}
+					break;
+				}
+			}
+		}
+
+		// Legal children of this position
+		void generateChildren(std::vector<Move>& moves, std::vector<Position>& children) const
+		{
+			std::vector<Move> pseudo;
+			generateMoves(pseudo);
+
+			moves.clear();
+			children.clear();
+
+			Position child;
+			for (const Move& m : pseudo)
+				if (makeMove(m, child))
+				{
+					moves.push_back(m);
+					children.push_back(child);
+				}
+		}
+	};
+
+	// Proof and disproof numbers are stored from the point of view of the side to move:
+	// phi is the proof number at OR (attacker) nodes and the disproof number at AND (defender) nodes
+	const uint32_t INF = 100000000;
+
+	inline uint32_t clampAdd(uint64_t a, uint64_t b) { return (uint32_t)std::min<uint64_t>(a + b, INF); }
+
+	// Fixed size table of proof numbers, four entry buckets, the least searched entry is replaced
+	class NodeTable {
+		struct Entry {
+			uint64_t key;
+			uint32_t phi, delta;
+			uint32_t work;
+		};
+
+		std::vector<Entry> entries;
+		size_t bucketMask;
+
+	public:
+		NodeTable(size_t bytes)
+		{
+			size_t buckets = 1;
+			while (buckets * 2 * 4 * sizeof(Entry) <= bytes) buckets *= 2;
+
+			entries.assign(buckets * 4, Entry{ 0, 0, 0, 0 });
+			bucketMask = buckets - 1;
+		}
+
+		bool lookup(uint64_t key, uint32_t& phi, uint32_t& delta) const
+		{
+			const Entry* bucket = &entries[(key & bucketMask) * 4];
+			for (int i = 0; i < 4; i++)
+				if (bucket[i].key == key && bucket[i].work)
+				{
+					phi = bucket[i].phi;
+					delta = bucket[i].delta;
+					return true;
+				}
+
+			return false;
+		}
+
+		void store(uint64_t key, uint32_t phi, uint32_t delta, uint32_t work)
+		{
+			Entry* bucket = &entries[(key & bucketMask) * 4];
+			Entry* replace = bucket;
+
+			for (int i = 0; i < 4; i++)
+			{
+				if (bucket[i].key == key) { replace = &bucket[i]; break; }
+				if (bucket[i].work < replace->work) replace = &bucket[i];
+			}
+
+			// Solved entries are worth keeping no matter how cheap they were
+			bool solved = phi == 0 || delta == 0;
+			*replace = Entry{ key, phi, delta, std::max<uint32_t>(work, 1) + (solved ? INF : 0) };
+		}
+	};
+
+	// Search state shared by the threads working on one puzzle
+	struct SharedState {
+		std::atomic<bool> stop{ false };
+		std::atomic<uint64_t> nodes{ 0 };
+		uint64_t nodeBudget = 0;
+	};
+
+	class MateSearch {
+		NodeTable table;
+		SharedState& shared;
+		uint64_t localNodes = 0;
+
+	public:
+		bool aborted = false;
+
+		MateSearch(size_t tableBytes, SharedState& state) : table(tableBytes), shared(state) {}
+
+		// Key of a node, the same position with a different number of attacker moves left is a different node
+		static uint64_t nodeKey(const Position& pos, int movesLeft) { return pos.hash ^ zobristKey(KEY_DEPTH + movesLeft); }
+
+		void lookupOrInit(const Position& pos, int movesLeft, uint32_t& phi, uint32_t& delta) const
+		{
+			if (!table.lookup(nodeKey(pos, movesLeft), phi, delta))
+			{
+				phi = 1;
+				delta = 1;
+			}
+		}
+
+		// Multiple iterative deepening step of df-pn, expands the node until a threshold is reached
+		void mid(const Position& pos, int movesLeft, bool orNode, uint32_t thPhi, uint32_t thDelta, uint32_t& phi, uint32_t& delta)
+		{
+			uint64_t key = nodeKey(pos, movesLeft);
+			uint32_t work = 1;
+
+			if ((++localNodes & 1023) == 0)
+			{
+				uint64_t total = shared.nodes.fetch_add(1024) + 1024;
+				if (shared.stop || (shared.nodeBudget && total >= shared.nodeBudget)) aborted = true;
+			}
+
+			if (aborted)
+			{
+				lookupOrInit(pos, movesLeft, phi, delta);
+				return;
+			}
+
+			// The attacker has run out of moves without mating
+			if (orNode && movesLeft == 0)
+			{
+				phi = INF; delta = 0;
+				table.store(key, phi, delta, work);
+				return;
+			}
+
+			std::vector<Move> moves;
+			std::vector<Position> children;
+			pos.generateChildren(moves, children);
+
+			if (children.empty())
+			{
+				// Checkmate proves the AND node, stalemate or a mated attacker disproves
+				bool mated = pos.inCheck();
+				if (orNode || !mated) { phi = orNode ? INF : 0; delta = orNode ? 0 : INF; }
+				else { phi = INF; delta = 0; }
+
+				table.store(key, phi, delta, work);
+				return;
+			}
+
+			int childMovesLeft = orNode ? movesLeft - 1 : movesLeft;
+
+			while (true)
+			{
+				// phi is the smallest child delta, delta the sum of child phis
+				uint64_t minDelta = INF, secondDelta = INF, sumPhi = 0;
+				size_t best = 0;
+				uint32_t bestPhi = 0;
+
+				for (size_t i = 0; i < children.size(); i++)
+				{
+					uint32_t cPhi, cDelta;
+					lookupOrInit(children[i], childMovesLeft, cPhi, cDelta);
+					sumPhi += cPhi;
+
+					if (cDelta < minDelta)
+					{
+						secondDelta = minDelta;
+						minDelta = cDelta;
+						best = i;
+						bestPhi = cPhi;
+					}
+					else if (cDelta < secondDelta)
+						secondDelta = cDelta;
+				}
+
+				phi = (uint32_t)minDelta;
+				delta = (uint32_t)std::min<uint64_t>(sumPhi, INF);
+
+				if (phi >= thPhi || delta >= thDelta || aborted)
+					break;
+
+				// The child may use the part of this node's delta threshold its siblings are not using
+				uint32_t childThPhi = thDelta >= INF ? INF : clampAdd(thDelta, bestPhi) - std::min<uint32_t>(delta, clampAdd(thDelta, bestPhi));
+				uint32_t childThDelta = (uint32_t)std::min<uint64_t>(thPhi, secondDelta + 1);
+
+				uint32_t cPhi, cDelta;
+				uint64_t before = localNodes;
+				mid(children[best], childMovesLeft, !orNode, childThPhi, childThDelta, cPhi, cDelta);
+				work = clampAdd(work, localNodes - before);
+			}
+
+			if (!aborted)
+				table.store(key, phi, delta, work);
+		}
+
+		// Solves a node completely, returns true if it is proven for the attacker
+		bool solve(const Position& pos, int movesLeft, bool orNode)
+		{
+			uint32_t phi, delta;
+			mid(pos, movesLeft, orNode, INF, INF, phi, delta);
+
+			shared.nodes += localNodes & 1023;
+			localNodes &= ~uint64_t(1023);
+
+			// At OR nodes phi is the proof number, at AND nodes delta is
+			return orNode ? phi == 0 : delta == 0;
+		}
+	};
+
+	enum class Result { MATE, NO_MATE, UNKNOWN };
+
+	struct Report {
+		Result eResult = Result::UNKNOWN;
+		std::vector<Move> keyMoves;
+		uint64_t nodes = 0;
+		double ms = 0.0;
+	};
+
+	// Splits the root moves across threads, each thread proves or disproves whole root moves with its own table
+	Report solveMateIn(const Position& root, int mateIn, int threadCount, size_t tableBytes, uint64_t nodeBudget, bool findAll)
+	{
+		auto start = std::chrono::steady_clock::now();
+		Report report;
+
+		std::vector<Move> moves;
+		std::vector<Position> children;
+		root.generateChildren(moves, children);
+
+		SharedState shared;
+		shared.nodeBudget = nodeBudget;
+
+		std::atomic<size_t> nextMove{ 0 };
+		std::atomic<bool> anyAborted{ false };
+		std::mutex reportLock;
+
+		auto worker = [&]() {
+			MateSearch search(tableBytes / threadCount, shared);
+
+			for (size_t i = nextMove++; i < children.size() && !shared.stop; i = nextMove++)
+			{
+				bool proven = search.solve(children[i], mateIn - 1, false);
+
+				if (search.aborted)
+				{
+					if (!shared.stop) anyAborted = true;
+					break;
+				}
+
+				if (proven)
+				{
+					std::lock_guard<std::mutex> lock(reportLock);
+					report.keyMoves.push_back(moves[i]);
+					if (!findAll) shared.stop = true;
+				}
+			}
+		};
+
+		std::vector<std::thread> workers;
+		for (int t = 0; t < threadCount; t++)
+			workers.emplace_back(worker);
+		for (std::thread& t : workers)
+			t.join();
+
+		if (!report.keyMoves.empty()) report.eResult = Result::MATE;
+		else if (!anyAborted) report.eResult = Result::NO_MATE;
+
+		report.nodes = shared.nodes;
+		report.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return report;
+	}
+}
+
+struct Settings {
+	int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+	size_t memoryMB = 64;
+	uint64_t nodeBudget = 0;
+	bool findAll = false;
+};
+
+static bool runPuzzle(const std::string& fen, int mateIn, const Settings& settings)
+{
+	Solver::Position pos;
+	if (!pos.loadFEN(fen) || mateIn < 1 || mateIn >= Solver::MAX_DEPTH)
+	{
+		std::cout << "INVALID: " << fen << std::endl;
+		return false;
+	}
+
+	Solver::Report report = Solver::solveMateIn(pos, mateIn, settings.threads, settings.memoryMB << 20, settings.nodeBudget, settings.findAll);
+
+	switch (report.eResult)
+	{
+	case Solver::Result::MATE:
+		std::cout << "MATE IN " << mateIn << ":";
+		for (const Solver::Move& m : report.keyMoves) std::cout << " " << m.str();
+		break;
+	case Solver::Result::NO_MATE:
+		std::cout << "NO MATE IN " << mateIn;
+		break;
+	default:
+		std::cout << "UNKNOWN (node budget)";
+		break;
+	}
+
+	std::cout << "  nodes: " << report.nodes << "  time: " << (int)report.ms << "ms  " << fen << std::endl;
+	return report.eResult == Solver::Result::MATE;
+}
+
+int main(int argc, char* argv[])
+{
+	Settings settings;
+	std::string batchPath;
+	std::vector<std::string> positional;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "-threads" && i + 1 < argc) settings.threads = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "-memory" && i + 1 < argc) settings.memoryMB = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "-nodes" && i + 1 < argc) settings.nodeBudget = std::strtoull(argv[++i], nullptr, 10);
+		else if (arg == "-all") settings.findAll = true;
+		else if (arg == "-batch" && i + 1 < argc) batchPath = argv[++i];
+		else positional.push_back(arg);
+	}
+
+	if (!batchPath.empty())
+	{
+		std::ifstream file(batchPath);
+		if (!file)
+		{
+			std::cout << "Could not open " << batchPath << std::endl;
+			return 1;
+		}
+
+		int solved = 0, total = 0;
+		std::string line;
+		while (std::getline(file, line))
+		{
+			size_t split = line.find(';');
+			if (line.empty() || line[0] == '#' || split == std::string::npos)
+				continue;
+
+			total++;
+			solved += runPuzzle(line.substr(0, split), std::atoi(line.c_str() + split + 1), settings);
+		}
+
+		std::cout << solved << "/" << total << " mates proven" << std::endl;
+		return 0;
+	}
+
+	if (positional.size() != 2)
+	{
+		std::cout << "Usage: ChessSolver [-threads T] [-memory MB] [-nodes BUDGET] [-all] \"<FEN>\" N" << std::endl;
+		std::cout << "       ChessSolver [-threads T] [-memory MB] [-nodes BUDGET] [-all] -batch <file>" << std::endl;
+		return 1;
+	}
+
+	runPuzzle(positional[0], std::atoi(positional[1].c_str()), settings);
+	return 0;
+}
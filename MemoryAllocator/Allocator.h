@@ -0,0 +1,380 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Mem {
+
+	// Index of the highest and lowest set bit of a non-zero value
+	inline int highestBit(size_t x)
+	{
+#if defined(_MSC_VER)
+		unsigned long i;
+#if defined(_WIN64)
+		_BitScanReverse64(&i, x);
+#else
+		_BitScanReverse(&i, (unsigned long)x);
+#endif
+		return (int)i;
+#else
+		return (int)(sizeof(unsigned long long) * 8 - 1) - __builtin_clzll((unsigned long long)x);
+#endif
+	}
+
+	inline int lowestBit(uint32_t x)
+	{
+#if defined(_MSC_VER)
+		unsigned long i;
+		_BitScanForward(&i, x);
+		return (int)i;
+#else
+		return __builtin_ctz(x);
+#endif
+	}
+
+	const size_t WORD = sizeof(size_t);
+	// Payloads are aligned to two words, which is what malloc gives on most platforms
+	const size_t ALIGN = 2 * WORD;
+	const int ALIGN_LOG2 = WORD == 8 ? 4 : 3;
+
+	// Each power of two of block sizes is split into SUB classes, below SMALL every class holds one size
+	const int SUB_LOG2 = 3;
+	const int SUB = 1 << SUB_LOG2;
+	const int SMALL_LOG2 = SUB_LOG2 + ALIGN_LOG2;
+	const size_t SMALL = (size_t)1 << SMALL_LOG2;
+	// Pools are at most a gigabyte, which is what the class bitmaps can cover
+	const int MAX_LOG2 = 30;
+	const int CLASSES = MAX_LOG2 - SMALL_LOG2 + 1;
+
+	/*
+		Block layout, sizes are whole blocks and multiples of ALIGN:
+
+		allocated:  [ tag | payload ...                              ]
+		free:       [ tag | next | prev | ...                  | tag ]
+
+		The tag is the size with two flags in its low bits. A free block ends with a copy of its tag, a boundary
+		tag, so the block after it can find its start. Allocated blocks have no footer, instead every tag says
+		whether the block before it is allocated, so a footer is only read when there is one.
+	*/
+	struct memBlock {
+		enum : size_t {
+			ALLOCATED = 1,
+			PREV_ALLOCATED = 2,
+			FLAGS = ALIGN - 1
+		};
+
+		size_t tag;
+		// Only there while the block is free
+		memBlock* next;
+		memBlock* prev;
+
+		size_t size() const { return tag & ~(size_t)FLAGS; }
+		bool allocated() const { return (tag & ALLOCATED) != 0; }
+		bool prevAllocated() const { return (tag & PREV_ALLOCATED) != 0; }
+
+		char* payload() { return (char*)this + WORD; }
+		memBlock* after() { return (memBlock*)((char*)this + size()); }
+		size_t& footer() { return *(size_t*)((char*)this + size() - WORD); }
+		// Only when the block before is free
+		memBlock* before() { return (memBlock*)((char*)this - (*(size_t*)((char*)this - WORD) & ~(size_t)FLAGS)); }
+
+		void setPrevAllocated(bool set) { tag = set ? tag | PREV_ALLOCATED : tag & ~(size_t)PREV_ALLOCATED; }
+
+		static memBlock* of(void* payload) { return (memBlock*)((char*)payload - WORD); }
+	};
+
+	// Smallest block that can hold the free list links and a footer
+	const size_t MIN_BLOCK = (sizeof(memBlock) + WORD + ALIGN - 1) & ~(ALIGN - 1);
+
+	// Free blocks in segregated lists by size class. A bitmap of the non-empty classes in every power of two, and
+	// one of the powers of two with any, make finding a class with a block big enough two bit scans.
+	class memList {
+	public:
+		memList() { clear(); }
+
+		void clear()
+		{
+			memset(heads, 0, sizeof(heads));
+			memset(classBits, 0, sizeof(classBits));
+			powerBits = 0;
+		}
+
+		void insert(memBlock* block)
+		{
+			int power, sub;
+			classOf(block->size(), power, sub);
+
+			memBlock*& head = heads[power][sub];
+			block->prev = nullptr;
+			block->next = head;
+			if (head) head->prev = block;
+			head = block;
+
+			classBits[power] |= 1u << sub;
+			powerBits |= 1u << power;
+		}
+
+		void remove(memBlock* block)
+		{
+			int power, sub;
+			classOf(block->size(), power, sub);
+
+			if (block->next) block->next->prev = block->prev;
+			if (block->prev) block->prev->next = block->next;
+			else
+			{
+				heads[power][sub] = block->next;
+				if (!block->next && !(classBits[power] &= ~(1u << sub)))
+					powerBits &= ~(1u << power);
+			}
+		}
+
+		// A free block of at least size, or nullptr. The size is rounded up to the next class first, so whatever
+		// block is found fits without searching its list. When that finds nothing the size's own class, whose
+		// blocks may or may not fit, is searched through as a last try.
+		memBlock* find(size_t size) const
+		{
+			if (size >> MAX_LOG2) return nullptr;
+
+			int power, sub;
+			size_t rounded = size < SMALL ? size : size + ((size_t)1 << (highestBit(size) - SUB_LOG2)) - 1;
+			if (!(rounded >> MAX_LOG2))
+			{
+				classOf(rounded, power, sub);
+				uint32_t subs = classBits[power] & (~0u << sub);
+				if (!subs)
+				{
+					uint32_t powers = powerBits & (~0u << (power + 1));
+					if (powers)
+					{
+						power = lowestBit(powers);
+						subs = classBits[power];
+					}
+				}
+				if (subs) return heads[power][lowestBit(subs)];
+			}
+
+			classOf(size, power, sub);
+			for (memBlock* block = heads[power][sub]; block; block = block->next)
+				if (block->size() >= size) return block;
+			return nullptr;
+		}
+
+		// Size class of a block size, which must be below 2^MAX_LOG2
+		static void classOf(size_t size, int& power, int& sub)
+		{
+			if (size < SMALL)
+			{
+				power = 0;
+				sub = (int)(size >> ALIGN_LOG2);
+			}
+			else
+			{
+				int high = highestBit(size);
+				power = high - SMALL_LOG2 + 1;
+				sub = (int)(size >> (high - SUB_LOG2)) - SUB;
+			}
+		}
+
+		memBlock* head(int power, int sub) const { return heads[power][sub]; }
+		bool classSet(int power, int sub) const { return (classBits[power] >> sub & 1) && (powerBits >> power & 1); }
+
+	private:
+		memBlock* heads[CLASSES][SUB];
+		uint32_t classBits[CLASSES];
+		uint32_t powerBits;
+	};
+
+	// A heap in a fixed pool that it never grows past, for when there is no system allocator or it cannot be
+	// trusted to take bounded time. Allocation takes a free block from the size classes and splits off what is
+	// left over, freeing merges the block with free neighbours on both sides through their boundary tags. Both are
+	// O(1) apart from the last try in memList::find. Not thread safe.
+	class Heap {
+	public:
+		// The pool has to outlive the heap, anything past a gigabyte of it is left unused
+		Heap(void* pool, size_t bytes)
+		{
+			if (bytes >> MAX_LOG2) bytes = ((size_t)1 << MAX_LOG2) - 1;
+
+			// Blocks start a word before an aligned address, so their payloads are aligned
+			uintptr_t at = (uintptr_t)pool;
+			uintptr_t start = ((at + WORD + ALIGN - 1) & ~(uintptr_t)(ALIGN - 1)) - WORD;
+			size_t usable = at + bytes >= start + WORD ? (at + bytes - start - WORD) & ~(ALIGN - 1) : 0;
+
+			first = (memBlock*)start;
+			capacity = usable >= MIN_BLOCK ? usable : 0;
+			// A tag with no size closes the pool, it reads as allocated so nothing merges past it
+			last = (memBlock*)(start + capacity);
+			if (at + bytes >= start + capacity + WORD) last->tag = memBlock::ALLOCATED;
+			else last = nullptr;
+
+			reset();
+		}
+
+		// Free everything at once
+		void reset()
+		{
+			lists.clear();
+			freeTotal = 0;
+			if (!capacity) return;
+
+			first->tag = capacity | memBlock::PREV_ALLOCATED;
+			first->footer() = first->tag;
+			last->tag = memBlock::ALLOCATED;
+			lists.insert(first);
+			freeTotal = capacity;
+		}
+
+		// Aligned space for n bytes, or nullptr when n is 0 or no free block is big enough
+		void* malloc(size_t n)
+		{
+			if (n == 0 || n >> MAX_LOG2) return nullptr;
+
+			size_t size = (n + WORD + ALIGN - 1) & ~(ALIGN - 1);
+			if (size < MIN_BLOCK) size = MIN_BLOCK;
+
+			memBlock* block = lists.find(size);
+			if (!block) return nullptr;
+			lists.remove(block);
+
+			// Split when what is left over is a block of its own, the block after the rest is already told the
+			// one before it is free
+			size_t spare = block->size() - size;
+			if (spare >= MIN_BLOCK)
+			{
+				block->tag = size | (block->tag & memBlock::PREV_ALLOCATED);
+				memBlock* rest = block->after();
+				rest->tag = spare | memBlock::PREV_ALLOCATED;
+				rest->footer() = rest->tag;
+				lists.insert(rest);
+			}
+			else
+				block->after()->setPrevAllocated(true);
+
+			block->tag |= memBlock::ALLOCATED;
+			freeTotal -= block->size();
+			return block->payload();
+		}
+
+		// Give back space from malloc. Returns false, changing nothing, for nullptr, a pointer from outside the
+		// pool or a block that is not allocated, which catches most double frees.
+		bool memfree(void* p)
+		{
+			if (!owns(p)) return false;
+			memBlock* block = memBlock::of(p);
+			if (!block->allocated()) return false;
+
+			// Cleared even when the tag ends up inside the block before, so freeing it again is still caught
+			block->tag &= ~(size_t)memBlock::ALLOCATED;
+			size_t size = block->size();
+			freeTotal += size;
+
+			memBlock* next = block->after();
+			if (!next->allocated())
+			{
+				lists.remove(next);
+				size += next->size();
+			}
+			else
+				next->setPrevAllocated(false);
+
+			size_t prevAllocated = memBlock::PREV_ALLOCATED;
+			if (!block->prevAllocated())
+			{
+				block = block->before();
+				lists.remove(block);
+				size += block->size();
+				prevAllocated = block->tag & memBlock::PREV_ALLOCATED;
+			}
+
+			block->tag = size | prevAllocated;
+			block->footer() = block->tag;
+			lists.insert(block);
+			return true;
+		}
+
+		// Bytes that can be used from a pointer malloc gave, at least what was asked for
+		size_t usableSize(void* p) const
+		{
+			if (!owns(p)) return 0;
+			memBlock* block = memBlock::of(p);
+			return block->allocated() ? block->size() - WORD : 0;
+		}
+
+		bool owns(void* p) const
+		{
+			uintptr_t at = (uintptr_t)p;
+			return capacity && at >= (uintptr_t)first + WORD && at < (uintptr_t)last && (at & (ALIGN - 1)) == 0;
+		}
+
+		size_t size() const { return capacity; }
+		// Bytes in free blocks, counting their tags
+		size_t freeBytes() const { return freeTotal; }
+
+		// Walk every block and every free list and check they agree. Returns what is wrong, or nullptr when
+		// nothing is. Takes time in the size of the heap, it is for testing.
+		const char* check() const
+		{
+			if (!capacity) return nullptr;
+
+			size_t blocks = 0, freeBlocks = 0, freeSeen = 0;
+			bool prevAllocated = true;
+			memBlock* block = first;
+			while (block != last)
+			{
+				size_t size = block->size();
+				if (size < MIN_BLOCK || size & (ALIGN - 1)) return "block size is not a whole block";
+				if ((uintptr_t)block + size > (uintptr_t)last) return "block runs past the end of the pool";
+				if (block->prevAllocated() != prevAllocated) return "tag has the wrong flag for the block before";
+
+				if (!block->allocated())
+				{
+					if (!prevAllocated) return "two free blocks next to each other";
+					if (block->footer() != block->tag) return "free block footer does not match its tag";
+
+					int power, sub;
+					memList::classOf(size, power, sub);
+					if (!lists.classSet(power, sub)) return "free block in a class marked empty";
+					memBlock* listed = lists.head(power, sub);
+					while (listed && listed != block) listed = listed->next;
+					if (!listed) return "free block missing from its class list";
+
+					freeBlocks++;
+					freeSeen += size;
+				}
+
+				prevAllocated = block->allocated();
+				block = block->after();
+				blocks++;
+			}
+			if (last->prevAllocated() != prevAllocated) return "end tag has the wrong flag for the last block";
+			if (freeSeen != freeTotal) return "free byte count is off";
+
+			size_t listed = 0;
+			for (int power = 0; power < CLASSES; power++)
+				for (int sub = 0; sub < SUB; sub++)
+				{
+					if (lists.classSet(power, sub) != (lists.head(power, sub) != nullptr)) return "class bitmap does not match its list";
+					for (memBlock* b = lists.head(power, sub); b; b = b->next)
+					{
+						if (b->next && b->next->prev != b) return "free list link is broken";
+						if (++listed > freeBlocks) return "free list holds more blocks than the pool";
+					}
+				}
+			if (listed != freeBlocks) return "free list holds fewer blocks than the pool";
+			return nullptr;
+		}
+
+	private:
+		memBlock* first;
+		memBlock* last;
+		size_t capacity;
+		size_t freeTotal;
+		memList lists;
+	};
+}
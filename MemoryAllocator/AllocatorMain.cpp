@@ -1,288 +1,271 @@
-//#include <iostream>
-//#include <vector>
-//#include <unordered_map>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
 
-/*
-#define memSize 1000
-#define BYTE_SZ 8
-#define MAX_MEM_MOD 32
-#define EXIT 0
-#define ERR 1
-
-char setByte(bool x1, bool x2, bool x3, bool x4, bool x5, bool x6, bool x7, bool x8)
-{
-    return (x1) + (x2 << 1) + (x3 << 2) + (x4 << 3) + (x5 << 4) + (x6 << 5) + (x7 << 6) + (x8 << 7);
-}
-
-#define BOOLEAN_DEFAULT setByte(0, 0,0,1, 0,0,0,0)
-
-char NULLHEAD = setByte(0, 1,1,1, 0,0,0,0);
-char NULLPTR = -1;
-
-/*
-    head = 1 byte
-     0  - to be collected
-     1-3- type (8 posible types)
-     4-7- size (min = 1, max = 256)
-
-    types:
-    0: Pointer = 1 byte (65536 addr)
-       - Void: 0111 size 000...
-    1: Bool = head + 1 byte
-    2: Char = head + 1-256 bytes
-    3: Int = head + 2-64 bytes
-       - Twos compement
-       - Operators: + - * % / <=>
-    4: Str = head + 1-256 bytes + ptr
+#include "Allocator.h"
 
 /*
-#define ERROR 0
-#define WARNING 1
-#define MESSAGE 2
-
-const std::vector<std::string> SEVARITIES = { "ERROR", "WARNING", "MESSAGE" };
-
-struct err {
-    int sev, type;
-    std::string msg;
-
-    friend std::ostream& operator<< (std::ostream& _stream, err& _rhs)
-    {
-        _stream << SEVARITIES[_rhs.sev] << " #" << _rhs.type << ": " << _rhs.msg;
-        return _stream;
-    }
-};
-
-
-struct memBlock;
-struct ptr;
-struct boolean;
-struct integer;
-struct character;
-struct string;
-
-int memset(bool _set, int _from = 0, int _to = memSize);
-ptr malloc(int _size);
-
-auto set = [](char& _byte, unsigned int _ind, bool _val = 1) { _val ? _byte |= (1 << _ind) : _byte &= (~(1 << _ind)); };
-auto tog = [](char& _byte, unsigned int _ind) { _byte ^= (1 << _ind); };
-auto get = [](const char& _byte, unsigned int _ind) { return _byte & (1 << _ind); };
-
-struct memBlock {
-    char start;
-    char size;
-    //memBlock *next, *prev;
-
-    memBlock(char _start, char _size) : start(_start), size(_size) {}
-
-    memBlock split(int _size)
-    {
-        size -= _size;
-        return memBlock(start + _size, _size);
-    }
-    char end() { return start + size; }
-};
-
-/*
-class memList {
-    int count;
-    std::vector<memBlock*> list;
-
-    memBlock* head;
-    memBlock* tail;
-
-public:
-    
-    memList() { count = 0;  }
-
-    // Returns the closest node to _pos, always to the right (less than) _pos
-    memBlock* findRightNeighbor(char _pos)
-    {
-        memBlock* guess = list[(int) ((count - 1) * (1.0f * head->start / _pos))];
-        bool direction = guess->start > _pos;
-
-        while (guess->start > _pos == direction)
-            direction ? guess = guess->prev : guess = guess->next;
-
-        return direction ? guess : guess->prev;
-    }
-
-    memBlock* binarySearchRightNeighbor(char _pos)
-    {
-        char inc = count - 1;
-        char guess = (count - 1) / 2;
-
-        while (count > 1)
-        {
-            if (guess == 0 || guess == count - 1 || list[guess]->start > _pos && list[guess + 1]->start < _pos)
-                return list[guess];
-            else if (list[guess]->start < _pos)
-                guess += (count /= 2);
-            else
-                guess -= (count /= 2);
-        }
-
-        return nullptr;
-    }
-
-    void insert(memBlock* _ins)
-    {
-        if (memBlock* rightNeighbor = binarySearchRightNeighbor(_ins->start))
-        {
-            rightNeighbor->next->prev = _ins;
-            _ins->next = rightNeighbor->next;
-            _ins->prev = rightNeighbor;
-            rightNeighbor->next = _ins;
-
-            count++;
-        }
-        else
-            return;
-    }
-};
-
-
-char mem[memSize];
-std::vector<memBlock> free;
-std::vector<memBlock> allocated;
-
-int setByteRange(char& _byte, bool _set, int _from = 0, int _to = BYTE_SZ)
-{
-    if (_from >= _to || _to >= BYTE_SZ)
-        return ERR;
-
-    for (unsigned int i = _from; i < _to; i++)
-        set(_byte, i, _set);
-
-    return EXIT;
-}
-
-int copyByte(char& _curr, const char& _copy)
-{
-    for (unsigned int i = 0; i < BYTE_SZ; i++)
-        set(_curr, i, get(_copy, i));
-}
-
-int copyByteRange(char& _curr, int _at, const char& _copy, int _from = 0, int _to = BYTE_SZ)
-{
-    if (_from >= _to || _to >= BYTE_SZ || _at + _from - _to >= BYTE_SZ)
-        return ERR;
-
-    for (unsigned int i = _from; i < _to; i++)
-        set(_curr, i + _at, get(_copy, i));
-
-    return EXIT;
-}
-
-int   memset(bool _set, int _from = 0, int _to = memSize)
-{
-    if (_from >= _to)
-        return ERR;
-
-    for (int i = _from; i < _to; i++)
-        set(mem[i / BYTE_SZ], i % BYTE_SZ, _set);
-
-    return EXIT;
-}
-
-char& memget(ptr& _at)
-{
-    if (_at.val >= memSize)
-        return NULLPTR;
-
-    return mem[_at.val];
-}
-
-char& memget(char& _at)
-{
-    if (_at >= memSize)
-        return NULLPTR;
-
-    return mem[_at];
-}
-
-ptr malloc(int _size)
-{
-    for(memBlock& b : free)
-        if (b.size < _size)
-        {
-            ptr newAlloc = ptr(b.split(_size));
-        }
-}
+MEMORY ALLOCATOR
+A free-list heap over a fixed pool, see Allocator.h. Run on its own this checks the heap: a set of cases for
+splitting, coalescing, running out and bad frees, then random mallocs and frees against a record of every live
+allocation, with the heap's own consistency check run as it goes. Prints a line per case and returns non-zero
+when any of them fail.
+
+Usage:
+	MemoryAllocator [-seed N] [-ops N]
+*/
 
-int memfree(ptr& _at)
-{
-    for (memBlock& block : free)
-    {
-        if (block.end() + 1 == _at.val)
-            ;
-    }
-    // Search free blocks to try and merge neighboring free blocks
-    // Else, create a new block and append it to free
-    // Change type to null
+namespace Check {
+
+	const size_t memSize = 1 << 20;
+	alignas(16) char mem[memSize];
+
+	int failures = 0;
+
+	// Report a case, with the first thing that went wrong in it
+	void report(const std::string& name, const std::string& problem)
+	{
+		if (problem.empty()) std::cout << "PASS " << name << std::endl;
+		else
+		{
+			std::cout << "FAIL " << name << ": " << problem << std::endl;
+			failures++;
+		}
+	}
+
+	// The heap's own check as a problem, or nothing
+	std::string consistent(const Mem::Heap& heap)
+	{
+		const char* problem = heap.check();
+		return problem ? problem : "";
+	}
+
+	std::string fresh()
+	{
+		Mem::Heap heap(mem, memSize);
+		if (heap.size() == 0 || heap.size() > memSize) return "pool has the wrong size";
+		if (heap.freeBytes() != heap.size()) return "a new heap is not all free";
+		return consistent(heap);
+	}
+
+	std::string alignment()
+	{
+		Mem::Heap heap(mem + 3, memSize - 3);
+		std::vector<char*> live;
+		for (size_t n = 1; n <= 4096; n += n / 8 + 1)
+		{
+			char* p = (char*)heap.malloc(n);
+			if (!p) return "ran out of space";
+			if ((uintptr_t)p % Mem::ALIGN) return "payload of " + std::to_string(n) + " bytes is not aligned";
+			if (heap.usableSize(p) < n) return "usable size below what was asked for";
+			live.push_back(p);
+		}
+		for (char* p : live)
+			if (!heap.memfree(p)) return "could not free";
+		return consistent(heap);
+	}
+
+	// Allocations never overlap: each is filled with its own byte and read back once they all exist
+	std::string overlap()
+	{
+		Mem::Heap heap(mem, memSize);
+		std::vector<std::pair<char*, size_t>> live;
+		for (size_t i = 0; i < 500; i++)
+		{
+			size_t n = 1 + (i * 37) % 300;
+			char* p = (char*)heap.malloc(n);
+			if (!p) return "ran out of space";
+			memset(p, (int)(i & 0xFF), n);
+			live.push_back({ p, n });
+		}
+		for (size_t i = 0; i < live.size(); i++)
+			for (size_t k = 0; k < live[i].second; k++)
+				if ((unsigned char)live[i].first[k] != (i & 0xFF)) return "allocation " + std::to_string(i) + " was written over";
+		return consistent(heap);
+	}
+
+	std::string limits()
+	{
+		Mem::Heap heap(mem, memSize);
+		if (heap.malloc(0)) return "malloc(0) gave space";
+		if (heap.malloc(memSize)) return "malloc of the whole pool and more gave space";
+		if (heap.malloc((size_t)-1)) return "malloc of the largest size_t gave space";
+
+		// The whole pool at once, less its tag
+		void* all = heap.malloc(heap.size() - Mem::WORD);
+		if (!all) return "could not take the whole pool";
+		if (heap.freeBytes() != 0) return "the whole pool taken but some left free";
+		if (heap.malloc(1)) return "gave space from a full pool";
+		if (!heap.memfree(all)) return "could not free the whole pool";
+		if (heap.freeBytes() != heap.size()) return "freeing the whole pool left some taken";
+
+		// Tiny pools
+		char small[64];
+		Mem::Heap none(small, 8);
+		if (none.size() != 0 || none.malloc(1)) return "a pool too small for a block gave space";
+		Mem::Heap one(small, sizeof(small));
+		if (one.size() == 0 || !one.malloc(1) || one.malloc(1)) return "a pool for one block did not hold exactly one";
+		return consistent(heap);
+	}
+
+	// Free blocks merge with both neighbours, in whichever order they are freed
+	std::string coalescing()
+	{
+		Mem::Heap heap(mem, 4096);
+		size_t total = heap.size();
+
+		const int orders[][3] = { { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 } };
+		for (const int* order : orders)
+		{
+			void* p[4];
+			for (void*& q : p)
+				if (!(q = heap.malloc(100))) return "ran out of space";
+
+			for (int i = 0; i < 3; i++)
+			{
+				heap.memfree(p[order[i]]);
+				std::string problem = consistent(heap);
+				if (!problem.empty()) return problem;
+			}
+			// Three blocks freed next to each other have to come back as one
+			if (!heap.malloc(3 * 100)) return "three freed neighbours did not merge";
+			heap.reset();
+		}
+
+		// Freeing everything in a checkerboard, then the rest, leaves one block
+		std::vector<void*> live;
+		while (void* q = heap.malloc(24)) live.push_back(q);
+		for (size_t i = 0; i < live.size(); i += 2) heap.memfree(live[i]);
+		std::string problem = consistent(heap);
+		if (!problem.empty()) return problem;
+		if (heap.malloc(64)) return "space between allocations merged across them";
+		for (size_t i = 1; i < live.size(); i += 2) heap.memfree(live[i]);
+		if (heap.freeBytes() != total) return "space was lost";
+		if (!heap.malloc(total - Mem::WORD)) return "the freed pool did not merge back into one block";
+		return consistent(heap);
+	}
+
+	// A freed block of every size class is found again by a request of the same size when it is the only one that
+	// fits, which for most sizes takes the search through the size's own class
+	std::string classes()
+	{
+		Mem::Heap heap(mem, memSize);
+		for (size_t n = 1; n <= 64 * 1024; n += n < 512 ? 1 : n / 16)
+		{
+			void* fence = heap.malloc(16);
+			void* p = heap.malloc(n);
+			void* rest = heap.malloc(heap.freeBytes() - Mem::WORD);
+			if (!fence || !p || !rest) return "ran out of space";
+
+			heap.memfree(p);
+			if (heap.malloc(n) != p) return "a freed block of " + std::to_string(n) + " bytes was not found again";
+			heap.reset();
+		}
+		return consistent(heap);
+	}
+
+	std::string badFrees()
+	{
+		Mem::Heap heap(mem, 4096);
+		int local;
+		if (heap.memfree(nullptr)) return "freed nullptr";
+		if (heap.memfree(&local)) return "freed a pointer from outside the pool";
+
+		char* a = (char*)heap.malloc(40);
+		char* b = (char*)heap.malloc(40);
+		if (heap.memfree(a + 1)) return "freed a pointer into the middle of a block";
+		if (!heap.memfree(a)) return "could not free";
+		if (heap.memfree(a)) return "freed the same block twice";
+		// Merged into the block before it, leaving its old tag inside that one
+		if (!heap.memfree(b)) return "could not free";
+		if (heap.memfree(b)) return "a block merged away was freed twice";
+		return consistent(heap);
+	}
+
+	// Random mallocs and frees, keeping a record of each allocation and its contents
+	std::string randomOps(unsigned seed, int ops)
+	{
+		Mem::Heap heap(mem, memSize);
+		std::mt19937 rng(seed);
+
+		struct Allocation { char* p; size_t n; unsigned char fill; };
+		std::vector<Allocation> live;
+		size_t taken = 0;
+
+		for (int op = 0; op < ops; op++)
+		{
+			// Mostly small, now and then large, and freeing more often once the pool fills up
+			bool allocate = live.empty() || rng() % 100 < (taken < memSize / 2 ? 60u : 40u);
+			if (allocate)
+			{
+				size_t n = rng() % 10 ? 1 + rng() % 256 : 1 + rng() % 32768;
+				char* p = (char*)heap.malloc(n);
+				if (!p) continue;
+				if ((uintptr_t)p % Mem::ALIGN) return "payload is not aligned";
+
+				unsigned char fill = (unsigned char)rng();
+				memset(p, fill, n);
+				live.push_back({ p, n, fill });
+				taken += n;
+			}
+			else
+			{
+				size_t i = rng() % live.size();
+				Allocation a = live[i];
+				for (size_t k = 0; k < a.n; k++)
+					if ((unsigned char)a.p[k] != a.fill) return "allocation was written over by op " + std::to_string(op);
+				if (!heap.memfree(a.p)) return "could not free a live allocation";
+
+				live[i] = live.back();
+				live.pop_back();
+				taken -= a.n;
+			}
+
+			if (op % 1000 == 0)
+			{
+				std::string problem = consistent(heap);
+				if (!problem.empty()) return problem + " after op " + std::to_string(op);
+			}
+		}
+
+		for (const Allocation& a : live)
+			if (!heap.memfree(a.p)) return "could not free a live allocation";
+		if (heap.freeBytes() != heap.size()) return "space was lost";
+		if (!heap.malloc(heap.size() - Mem::WORD)) return "the freed pool did not merge back into one block";
+		return consistent(heap);
+	}
 }
 
-struct ptr
-{
-    char& val;
-
-    ptr() : val(NULLPTR) {}
-
-    // Blank pointer, just has null pointer type (111) and it's size
-    ptr(memBlock block) : val(NULLHEAD)
-    {
-        val = memget(block.start);
-        copyByteRange(val, 4, block.size, 0, 4);
-    }
-
-    //char size() { return }
-
-    char type() {}
-
-    ptr& operator= (const ptr& rhs) { val = rhs.val; return *this; }
-
-    operator char() { return val; }
-};
-
-struct boolean {
-    char& val;
-    ptr loc;
-
-    // Create a new boolean
-    boolean(bool b) : val(NULLPTR)
-    {
-        loc = malloc(1);
-        val = memget(loc);
-        copyByte(val, BOOLEAN_DEFAULT);
-        setByteRange(val, b, 4);
-    }
-
-    // Get value from pointer
-    boolean(ptr& _from) : val(NULLPTR)
-    {
-        val = memget(_from);
-    }
-
-    ~boolean() { memfree(loc); }
-
-    boolean& operator= (const boolean& rhs) { val = rhs.val; return *this; }
-    bool operator== (const boolean& rhs) { return get(rhs.val, 4) == get(val, 4); }
-
-    operator char() { return val; }
-    operator bool() { return get(val, 4); }
-};
-
-struct integer {
-    char& head;
-    ptr loc;
-};
-
-int main()
+// MemoryAllocator.exe [-seed N] [-ops N]
+int main(int argc, char* argv[])
 {
-	memset(false);
-
-
+	unsigned seed = 1;
+	int ops = 200000;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string flag = argv[i];
+		if (flag == "-seed") seed = (unsigned)strtoul(argv[i + 1], nullptr, 10);
+		else if (flag == "-ops") ops = atoi(argv[i + 1]);
+		else
+		{
+			std::cerr << "Unknown option " << flag << std::endl;
+			return 2;
+		}
+	}
+
+	Check::report("fresh", Check::fresh());
+	Check::report("alignment", Check::alignment());
+	Check::report("overlap", Check::overlap());
+	Check::report("limits", Check::limits());
+	Check::report("coalescing", Check::coalescing());
+	Check::report("classes", Check::classes());
+	Check::report("bad frees", Check::badFrees());
+	Check::report("random", Check::randomOps(seed, ops));
+
+	std::cout << (Check::failures ? "FAILED " + std::to_string(Check::failures) : std::string("All passed")) << std::endl;
+	return Check::failures ? 1 : 0;
 }
-*/
-
-int main() { return 0; }
\ No newline at end of file
@@ -0,0 +1,336 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+
+#if defined(_WIN32)
+#include <io.h>
+#endif
+
+#define UTIL_TEXT_FILE
+#include "olcUtility.h"
+#include "PieceTable.h"
+
+namespace Text {
+
+	// Fixed size ring for exactly one producer thread and one consumer thread, neither ever waits on the other
+	template <class T>
+	class SpscQueue {
+	public:
+		explicit SpscQueue(size_t capacity)
+		{
+			size_t size = 1;
+			while (size < capacity) size *= 2;
+			slots.resize(size);
+		}
+
+		// False when the ring is full
+		bool push(T&& item)
+		{
+			size_t t = tail.load(std::memory_order_relaxed);
+			if (t - head.load(std::memory_order_acquire) == slots.size()) return false;
+
+			slots[t & (slots.size() - 1)] = std::move(item);
+			tail.store(t + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool pop(T& item)
+		{
+			size_t h = head.load(std::memory_order_relaxed);
+			if (h == tail.load(std::memory_order_acquire)) return false;
+
+			item = std::move(slots[h & (slots.size() - 1)]);
+			head.store(h + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		std::vector<T> slots;
+		// Each end on its own cache line
+		alignas(64) std::atomic<size_t> head{ 0 };
+		alignas(64) std::atomic<size_t> tail{ 0 };
+	};
+
+	// Crash recovery for a document saved at path. Edits are handed to a background thread through a lock-free
+	// queue, so the editing thread never touches the disk. The thread keeps its own copy of the text, appends
+	// each edit to path.journal and syncs the journal at most once every syncInterval seconds. After idleSeconds
+	// with no edits it writes its copy to path.autosave and starts the journal again. Saving the document
+	// removes both files.
+	//
+	// The journal starts with the size and hash of the text it applies to, then holds one record per edit:
+	// kind, offset and length, followed by the text for an insert.
+	class Autosave {
+	public:
+		double syncInterval = 1.0, idleSeconds = 3.0;
+
+		Autosave() {}
+		Autosave(const Autosave&) = delete;
+		~Autosave() { stop(); }
+
+		// Load what a crash left behind for path into text: the autosave if there is one, then any journal that was
+		// written for that text. False when there was nothing to recover.
+		static bool recover(const std::string& path, PieceTable& text)
+		{
+			bool recovered = false;
+
+			std::shared_ptr<util::TextFile> snapshot = std::make_shared<util::TextFile>();
+			if (snapshot->open(path + ".autosave"))
+			{
+				text = PieceTable(snapshot->data(), snapshot->size(), snapshot);
+				recovered = true;
+			}
+
+			// A journal written against other text is stale
+			std::ifstream journal(path + ".journal", std::ios::binary);
+			uint64_t header[2];
+			if (!journal.read((char*)header, sizeof(header)) || header[0] != text.size() || header[1] != hash(text))
+			{
+				journal.close();
+				std::remove((path + ".journal").c_str());
+				return recovered;
+			}
+
+			// Stop at the first record cut short by the crash
+			Record record;
+			std::string inserted;
+			while (journal.read((char*)&record, sizeof(record)) && record.kind <= ERASE && record.offset <= text.size())
+			{
+				if (record.kind == INSERT)
+				{
+					inserted.resize((size_t)record.length);
+					if (!journal.read(&inserted[0], inserted.size())) break;
+					text.insert((size_t)record.offset, inserted);
+				}
+				else
+					text.erase((size_t)record.offset, (size_t)record.length);
+				recovered = true;
+			}
+
+			return recovered;
+		}
+
+		// Start journaling edits to the text, which is copied for the background thread. Recovered text is written
+		// to the autosave once editing goes idle, even if it is not edited again.
+		void start(const std::string& documentPath, const PieceTable& text, bool recovered = false)
+		{
+			stop();
+			path = documentPath;
+			replica = text;
+			unsnapped = recovered;
+			running = true;
+			worker = std::thread(&Autosave::run, this);
+		}
+
+		// Write out what is queued and wait for the thread. The journal is kept, so the edits survive until saved.
+		void stop()
+		{
+			if (!worker.joinable()) return;
+			while (!overflow.empty())
+			{
+				update();
+				std::this_thread::yield();
+			}
+			running = false;
+			worker.join();
+		}
+
+		bool active() const { return worker.joinable(); }
+
+		void inserted(size_t offset, const char* s, size_t n) { send({ INSERT, offset, n, std::string(s, n) }); }
+		void erased(size_t offset, size_t n) { send({ ERASE, offset, n, std::string() }); }
+		// The document matches its file again
+		void saved() { send({ SAVED, 0, 0, std::string() }); }
+
+		// Edits that found the queue full are held here and offered again, call once a frame
+		void update()
+		{
+			size_t sent = 0;
+			while (sent < overflow.size() && queue.push(std::move(overflow[sent]))) sent++;
+			overflow.erase(overflow.begin(), overflow.begin() + sent);
+		}
+
+	private:
+		enum Kind : uint8_t {
+			INSERT,
+			ERASE,
+			SAVED
+		};
+
+		struct Edit {
+			Kind kind;
+			size_t offset, length;
+			std::string text;
+		};
+
+#pragma pack(push, 1)
+		struct Record {
+			uint8_t kind;
+			uint64_t offset, length;
+		};
+#pragma pack(pop)
+
+		SpscQueue<Edit> queue{ 4096 };
+		std::vector<Edit> overflow;
+		std::thread worker;
+		std::atomic<bool> running{ false };
+
+		// Only the background thread touches these once it has started
+		std::string path;
+		PieceTable replica;
+		std::FILE* journal = nullptr;
+		std::string pending;
+		bool unsnapped = false;
+
+		void send(Edit&& edit)
+		{
+			if (!active()) return;
+			if (!overflow.empty() || !queue.push(std::move(edit)))
+				overflow.push_back(std::move(edit));
+		}
+
+		// FNV-1a over the text, ties a journal to the text it was written against
+		static uint64_t hash(const PieceTable& text)
+		{
+			uint64_t h = 0xCBF29CE484222325ull;
+			for (const PieceTable::Piece& piece : text.getPieces())
+			{
+				const uint8_t* data = (const uint8_t*)text.pieceData(piece);
+				for (size_t i = 0; i < piece.length; i++)
+					h = (h ^ data[i]) * 0x100000001B3ull;
+			}
+			return h;
+		}
+
+		static void sync(std::FILE* file)
+		{
+			std::fflush(file);
+#if defined(_WIN32)
+			_commit(_fileno(file));
+#else
+			fsync(fileno(file));
+#endif
+		}
+
+		void run()
+		{
+			using clock = std::chrono::steady_clock;
+			clock::time_point lastEdit = clock::now(), lastSync = lastEdit;
+			bool unsynced = false;
+			Edit edit;
+
+			while (true)
+			{
+				// Read before draining, so nothing queued before stop() is missed
+				bool stopping = !running.load(std::memory_order_acquire);
+
+				bool any = false;
+				while (queue.pop(edit))
+				{
+					apply(edit);
+					any = true;
+				}
+
+				clock::time_point now = clock::now();
+				if (any) lastEdit = now;
+
+				if (journal && !pending.empty())
+				{
+					std::fwrite(pending.data(), 1, pending.size(), journal);
+					std::fflush(journal);
+					pending.clear();
+					unsynced = true;
+				}
+
+				// Many edits share one sync
+				if (journal && unsynced && (stopping || std::chrono::duration<double>(now - lastSync).count() >= syncInterval))
+				{
+					sync(journal);
+					lastSync = now;
+					unsynced = false;
+				}
+
+				if (unsnapped && !stopping && std::chrono::duration<double>(now - lastEdit).count() >= idleSeconds)
+				{
+					snapshot();
+					unsynced = false;
+				}
+
+				if (stopping) break;
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			}
+
+			if (journal) std::fclose(journal);
+			journal = nullptr;
+		}
+
+		void apply(const Edit& edit)
+		{
+			if (edit.kind == SAVED)
+			{
+				closeJournal();
+				std::remove((path + ".autosave").c_str());
+				std::remove((path + ".journal").c_str());
+				unsnapped = false;
+				return;
+			}
+
+			openJournal();
+			if (journal)
+			{
+				Record record{ (uint8_t)edit.kind, edit.offset, edit.length };
+				pending.append((const char*)&record, sizeof(record));
+				if (edit.kind == INSERT) pending += edit.text;
+			}
+
+			if (edit.kind == INSERT)
+				replica.insert(edit.offset, edit.text);
+			else
+				replica.erase(edit.offset, edit.length);
+			unsnapped = true;
+		}
+
+		// A journal already on disk is carried on, a new one starts with the text it applies to
+		void openJournal()
+		{
+			if (journal) return;
+
+			journal = std::fopen((path + ".journal").c_str(), "ab");
+			if (!journal) return;
+
+			std::fseek(journal, 0, SEEK_END);
+			if (std::ftell(journal) == 0)
+			{
+				uint64_t header[2] = { replica.size(), hash(replica) };
+				pending.insert(0, (const char*)header, sizeof(header));
+			}
+		}
+
+		void closeJournal()
+		{
+			if (journal) std::fclose(journal);
+			journal = nullptr;
+			pending.clear();
+		}
+
+		// Replace the autosave with the current text, once it is safely on disk the journal is no longer needed
+		void snapshot()
+		{
+			std::vector<std::pair<const char*, size_t>> chunks;
+			for (const PieceTable::Piece& piece : replica.getPieces())
+				chunks.push_back({ replica.pieceData(piece), piece.length });
+
+			if (!util::TextFile::save(path + ".autosave", chunks, true)) return;
+
+			closeJournal();
+			std::remove((path + ".journal").c_str());
+			unsnapped = false;
+		}
+	};
+}
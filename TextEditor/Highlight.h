@@ -0,0 +1,296 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cctype>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "PieceTable.h"
+
+namespace Text {
+
+	enum class TokenKind : uint8_t {
+		PLAIN,
+		KEYWORD,
+		NUMBER,
+		STRING,
+		COMMENT,
+		PREPROCESSOR,
+		COUNT
+	};
+
+	struct Token {
+		size_t start, length;
+		TokenKind kind;
+	};
+
+	// Splits one line into tokens for a language. The state is whatever a line leaves open for the next one, such
+	// as a block comment, and every document starts in state 0.
+	class Tokenizer {
+	public:
+		virtual ~Tokenizer() {}
+
+		// Tokens of the line in order, anything between them is plain. Returns the state the next line starts in,
+		// which must be below 255.
+		virtual uint8_t tokenize(const char* line, size_t n, uint8_t state, std::vector<Token>& out) const = 0;
+	};
+
+	// C and C++: comments, strings and characters, numbers, keywords and preprocessor directives
+	class CppTokenizer : public Tokenizer {
+	public:
+		enum State : uint8_t {
+			CODE,
+			BLOCK_COMMENT
+		};
+
+		uint8_t tokenize(const char* s, size_t n, uint8_t state, std::vector<Token>& out) const override
+		{
+			size_t i = 0;
+			if (state == BLOCK_COMMENT && !blockComment(s, n, i, 0, out)) return BLOCK_COMMENT;
+
+			// Only spaces may come before the # of a directive
+			size_t lead = i;
+			while (lead < n && (s[lead] == ' ' || s[lead] == '\t')) lead++;
+
+			while (i < n)
+			{
+				char c = s[i];
+				if (c == '/' && i + 1 < n && s[i + 1] == '/')
+				{
+					out.push_back({ i, n - i, TokenKind::COMMENT });
+					break;
+				}
+				else if (c == '/' && i + 1 < n && s[i + 1] == '*')
+				{
+					if (!blockComment(s, n, i, i + 2, out)) return BLOCK_COMMENT;
+				}
+				else if (c == '#' && i == lead)
+				{
+					size_t end = i + 1;
+					while (end < n && (s[end] == ' ' || s[end] == '\t')) end++;
+					while (end < n && isWord(s[end])) end++;
+					out.push_back({ i, end - i, TokenKind::PREPROCESSOR });
+					i = end;
+				}
+				else if (c == '"' || c == '\'')
+				{
+					size_t end = i + 1;
+					while (end < n && s[end] != c) end += s[end] == '\\' ? 2 : 1;
+					end = std::min(end + 1, n);
+					out.push_back({ i, end - i, TokenKind::STRING });
+					i = end;
+				}
+				else if (isdigit((unsigned char)c) || (c == '.' && i + 1 < n && isdigit((unsigned char)s[i + 1])))
+				{
+					size_t end = i + 1;
+					while (end < n && (isWord(s[end]) || s[end] == '.' || s[end] == '\'')) end++;
+					out.push_back({ i, end - i, TokenKind::NUMBER });
+					i = end;
+				}
+				else if (isWord(c))
+				{
+					size_t end = i + 1;
+					while (end < n && isWord(s[end])) end++;
+					if (isKeyword(s + i, end - i)) out.push_back({ i, end - i, TokenKind::KEYWORD });
+					i = end;
+				}
+				else
+					i++;
+			}
+
+			return CODE;
+		}
+
+	private:
+		static bool isWord(char c) { return isalnum((unsigned char)c) || c == '_'; }
+
+		// A comment from i whose end is looked for from search, false when it runs on past the line
+		static bool blockComment(const char* s, size_t n, size_t& i, size_t search, std::vector<Token>& out)
+		{
+			size_t end = search;
+			while (end + 1 < n && !(s[end] == '*' && s[end + 1] == '/')) end++;
+
+			bool closed = end + 1 < n;
+			end = closed ? end + 2 : n;
+			out.push_back({ i, end - i, TokenKind::COMMENT });
+			i = end;
+			return closed;
+		}
+
+		static bool isKeyword(const char* s, size_t n)
+		{
+			// Sorted, looked up by bisection
+			static const char* const words[] = {
+				"alignas", "alignof", "asm", "auto", "bool", "break", "case", "catch", "char", "class", "const", "const_cast",
+				"constexpr", "continue", "decltype", "default", "delete", "do", "double", "dynamic_cast", "else", "enum",
+				"explicit", "extern", "false", "final", "float", "for", "friend", "goto", "if", "inline", "int", "int16_t",
+				"int32_t", "int64_t", "int8_t", "long", "mutable", "namespace", "new", "noexcept", "nullptr", "operator",
+				"override", "private", "protected", "public", "register", "reinterpret_cast", "return", "short", "signed",
+				"size_t", "sizeof", "static", "static_assert", "static_cast", "struct", "switch", "template", "this",
+				"thread_local", "throw", "true", "try", "typedef", "typeid", "typename", "uint16_t", "uint32_t", "uint64_t",
+				"uint8_t", "union", "unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while"
+			};
+			const char* const* end = words + sizeof(words) / sizeof(words[0]);
+
+			// Orders a word against the identifier, which has no terminator
+			auto compare = [s, n](const char* w) { int r = strncmp(w, s, n); return r != 0 ? r : (w[n] == '\0' ? 0 : 1); };
+			const char* const* found = std::lower_bound(words, end, 0, [&](const char* w, int) { return compare(w) < 0; });
+			return found != end && compare(*found) == 0;
+		}
+	};
+
+	// The tokenizer for a file, by its extension, or none for text that is not code
+	inline std::shared_ptr<const Tokenizer> tokenizerFor(const std::string& path)
+	{
+		static const char* const cpp[] = { ".c", ".cc", ".cpp", ".cxx", ".h", ".hh", ".hpp", ".inl" };
+
+		size_t dot = path.find_last_of("./\\");
+		if (dot == std::string::npos || path[dot] != '.') return nullptr;
+
+		std::string extension = path.substr(dot);
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+		for (const char* e : cpp)
+			if (extension == e) return std::make_shared<CppTokenizer>();
+		return nullptr;
+	}
+
+	// Syntax colours kept in the document's style runs. The state each line starts in is cached, so a line can be
+	// tokenized on its own, and only lines on or near the screen ever are. After an edit the lines from the edited
+	// one onward are tokenized again only until a line ends in the state that was cached for the next one, the
+	// lines after that are unchanged. Lines here are the document's paragraphs.
+	class Highlighter {
+	public:
+		Style palette[(size_t)TokenKind::COUNT];
+		// Lines either side of the screen that are styled ahead of scrolling
+		int margin = 16;
+
+		Highlighter()
+		{
+			palette[(size_t)TokenKind::KEYWORD].color = olc::Pixel(86, 156, 214);
+			palette[(size_t)TokenKind::NUMBER].color = olc::Pixel(181, 206, 168);
+			palette[(size_t)TokenKind::STRING].color = olc::Pixel(214, 157, 133);
+			palette[(size_t)TokenKind::COMMENT].color = olc::Pixel(87, 166, 74);
+			palette[(size_t)TokenKind::PREPROCESSOR].color = olc::Pixel(155, 155, 155);
+		}
+
+		bool active() const { return tokenizer != nullptr; }
+
+		// Start over on a document of count lines, nothing is tokenized until it is asked for
+		void reset(std::shared_ptr<const Tokenizer> language, int count)
+		{
+			tokenizer = std::move(language);
+			states.assign(tokenizer ? count : 0, 0);
+			styledWith.assign(states.size(), UNSTYLED);
+			known = cached = states.empty() ? 0 : 1;
+			dirty = -1;
+		}
+
+		// Lines line to line + removed were edited into lines line to line + added
+		void edited(int line, int removed, int added)
+		{
+			if (states.empty()) return;
+
+			states.erase(states.begin() + line + 1, states.begin() + line + 1 + removed);
+			states.insert(states.begin() + line + 1, added, 0);
+			styledWith.erase(styledWith.begin() + line + 1, styledWith.begin() + line + 1 + removed);
+			styledWith.insert(styledWith.begin() + line + 1, added, UNSTYLED);
+			styledWith[line] = UNSTYLED;
+
+			// Cached states after the edit move with their lines
+			auto shift = [&](int& i) { if (i > line + removed) i += added - removed; else if (i > line) i = line + 1; };
+			shift(cached);
+			shift(dirty);
+
+			dirty = std::max(dirty, line + added);
+			known = std::min(known, line + 1);
+			cached = std::max(cached, known);
+		}
+
+		// Make sure lines first to last, and the margin around them, are styled. span(line, offset, length) gives
+		// where a line is in the text, without its break.
+		template <class Span>
+		void update(const PieceTable& text, StyleRuns& styles, int first, int last, Span span)
+		{
+			if (states.empty()) return;
+
+			first = std::max(0, first - margin);
+			last = std::min((int)states.size() - 1, last + margin);
+
+			for (int i = std::min(first, known - 1); i <= last; i++)
+			{
+				bool restyle = i >= first && styledWith[i] != states[i];
+				// Lines before the screen are only tokenized to find the state the next one starts in
+				if (!restyle && i + 1 < known) continue;
+
+				size_t offset, length;
+				span(i, offset, length);
+				line.resize(length);
+				text.copy(offset, length, &line[0]);
+				tokens.clear();
+				uint8_t next = tokenizer->tokenize(line.data(), length, states[i], tokens);
+
+				if (restyle)
+				{
+					apply(styles, offset, length);
+					styledWith[i] = states[i];
+				}
+
+				if (i + 1 >= known && i + 1 < (int)states.size())
+				{
+					// Past every edit, a line ending in the state already cached for the next one means the cached
+					// states after it still hold
+					bool converged = i + 1 > dirty && i + 1 < cached && states[i + 1] == next;
+					states[i + 1] = next;
+					known = converged ? cached : i + 2;
+					// Stopping without meeting them, the cached states after this one follow on from the old one
+					if (!converged && i == last && known > dirty) cached = known;
+					cached = std::max(cached, known);
+					if (known > dirty) dirty = -1;
+				}
+			}
+		}
+
+	private:
+		enum : uint8_t { UNSTYLED = 255 };
+
+		std::shared_ptr<const Tokenizer> tokenizer;
+		// State each line starts in, right for lines before known and right before the last edits for lines
+		// before cached
+		std::vector<uint8_t> states;
+		// The start state a line was styled with, UNSTYLED until it is and again once it is edited
+		std::vector<uint8_t> styledWith;
+		int known = 0, cached = 0;
+		// Last line edited since the states were caught up, the states can only be trusted again after it
+		int dirty = -1;
+
+		std::string line;
+		std::vector<Token> tokens;
+		std::vector<StyleRuns::Run> spans;
+
+		// Turn the tokens into runs covering the whole line and put them in one go
+		void apply(StyleRuns& styles, size_t offset, size_t length)
+		{
+			spans.clear();
+			size_t at = 0;
+			auto add = [&](size_t n, TokenKind kind)
+			{
+				const Style& style = palette[(size_t)kind];
+				if (!spans.empty() && spans.back().style == style) spans.back().length += n;
+				else if (n) spans.push_back({ n, style });
+			};
+
+			for (const Token& token : tokens)
+			{
+				add(token.start - at, TokenKind::PLAIN);
+				add(token.length, token.kind);
+				at = token.start + token.length;
+			}
+			add(length - at, TokenKind::PLAIN);
+
+			styles.assign(offset, length, spans.data(), spans.size());
+		}
+	};
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+namespace Text {
+
+	// Fenwick (binary indexed) tree over per item counts, such as the lines or characters of each paragraph.
+	// Changing one count, the sum before an item and finding the item holding a running total are all O(log n).
+	// Counts are ints, or size_t where they are lengths of text.
+	template <class T>
+	class BasicFenwickTree {
+	public:
+		void build(const std::vector<T>& counts)
+		{
+			tree.assign(counts.size() + 1, 0);
+			for (size_t i = 1; i < tree.size(); i++)
+			{
+				tree[i] += counts[i - 1];
+				size_t parent = i + (i & (0 - i));
+				if (parent < tree.size()) tree[parent] += tree[i];
+			}
+		}
+
+		int size() const { return (int)tree.size() - 1; }
+
+		void add(int item, T delta)
+		{
+			for (size_t i = item + 1; i < tree.size(); i += i & (0 - i))
+				tree[i] += delta;
+		}
+
+		// Sum of the counts of items before this one
+		T prefix(int item) const
+		{
+			T sum = 0;
+			for (size_t i = item; i > 0; i -= i & (0 - i))
+				sum += tree[i];
+			return sum;
+		}
+
+		T total() const { return prefix(size()); }
+
+		// Item whose range holds position, the first item whose running total passes it
+		int find(T position) const
+		{
+			size_t item = 0, step = 1;
+			while (step * 2 < tree.size()) step *= 2;
+
+			for (; step > 0; step /= 2)
+				if (item + step < tree.size() && tree[item + step] <= position)
+				{
+					item += step;
+					position -= tree[item];
+				}
+
+			return (int)item;
+		}
+
+	private:
+		std::vector<T> tree;
+	};
+
+	typedef BasicFenwickTree<int> FenwickTree;
+
+	// Running totals over per item counts, like FenwickTree, where items can also be put in or taken out anywhere.
+	// The counts are kept in chunks of up to a few hundred, with one Fenwick tree over the chunks' totals and one
+	// over how many items each holds. A lookup is O(log n) to the chunk and a walk inside it, putting in or taking
+	// out items moves only the counts after them in their chunk, and the trees over the chunks are only built
+	// again, from each chunk's kept total, when a chunk splits or merges, about once every CHUNK items.
+	class CountIndex {
+	public:
+		void build(const std::vector<int>& counts)
+		{
+			chunks.clear();
+			sums.clear();
+			for (size_t i = 0; i < counts.size(); i += CHUNK)
+			{
+				chunks.emplace_back(counts.begin() + i, counts.begin() + std::min(counts.size(), i + CHUNK));
+				sums.push_back(sumOf(chunks.back()));
+			}
+			items = (int)counts.size();
+			rebuildChunks();
+		}
+
+		int size() const { return items; }
+
+		void add(int item, int delta)
+		{
+			int chunk = chunkOf(item);
+			chunks[chunk][item] += delta;
+			sums[chunk] += delta;
+			totals.add(chunk, delta);
+		}
+
+		// Sum of the counts of items before this one
+		int prefix(int item) const
+		{
+			if (item >= items) return totals.total();
+			int chunk = chunkOf(item);
+			int sum = totals.prefix(chunk);
+			for (int i = 0; i < item; i++) sum += chunks[chunk][i];
+			return sum;
+		}
+
+		int total() const { return totals.total(); }
+
+		// Item whose range holds position, the first item whose running total passes it
+		int find(int position) const
+		{
+			int chunk = totals.find(position);
+			if (chunk >= (int)chunks.size()) return items;
+
+			int item = sizes.prefix(chunk);
+			position -= totals.prefix(chunk);
+			for (int count : chunks[chunk])
+			{
+				if (position < count) return item;
+				position -= count;
+				item++;
+			}
+			return item;
+		}
+
+		// Put n items with the given counts in before item, which can be size() to add them at the end
+		void insert(int item, const int* counts, int n)
+		{
+			if (n <= 0) return;
+			if (chunks.empty())
+			{
+				chunks.emplace_back();
+				sums.push_back(0);
+				rebuildChunks();
+			}
+
+			int chunk = item >= items ? (int)chunks.size() - 1 : chunkOf(item);
+			if (item >= items) item = (int)chunks[chunk].size();
+			std::vector<int>& into = chunks[chunk];
+			into.insert(into.begin() + item, counts, counts + n);
+			items += n;
+
+			if ((int)into.size() > 2 * CHUNK)
+			{
+				// Cut it into chunks of CHUNK, the last one taking what is left over
+				std::vector<int> whole;
+				whole.swap(into);
+				std::vector<std::vector<int>> cut;
+				std::vector<int> cutSums;
+				for (size_t i = 0; i < whole.size(); )
+				{
+					size_t end = whole.size() - i < 2 * CHUNK ? whole.size() : i + CHUNK;
+					cut.emplace_back(whole.begin() + i, whole.begin() + end);
+					cutSums.push_back(sumOf(cut.back()));
+					i = end;
+				}
+				chunks.erase(chunks.begin() + chunk);
+				chunks.insert(chunks.begin() + chunk, cut.begin(), cut.end());
+				sums.erase(sums.begin() + chunk);
+				sums.insert(sums.begin() + chunk, cutSums.begin(), cutSums.end());
+				rebuildChunks();
+				return;
+			}
+
+			int sum = 0;
+			for (int i = 0; i < n; i++) sum += counts[i];
+			sums[chunk] += sum;
+			totals.add(chunk, sum);
+			sizes.add(chunk, n);
+		}
+
+		// Take out n items from item on
+		void erase(int item, int n)
+		{
+			n = std::min(n, items - item);
+			if (n <= 0) return;
+
+			bool reshaped = false;
+			int chunk = chunkOf(item), first = chunk;
+			items -= n;
+			while (n > 0)
+			{
+				std::vector<int>& from = chunks[chunk];
+				int taken = std::min(n, (int)from.size() - item), sum = 0;
+				for (int i = item; i < item + taken; i++) sum += from[i];
+				from.erase(from.begin() + item, from.begin() + item + taken);
+				sums[chunk] -= sum;
+				totals.add(chunk, -sum);
+				sizes.add(chunk, -taken);
+				n -= taken;
+
+				if (from.empty())
+				{
+					chunks.erase(chunks.begin() + chunk);
+					sums.erase(sums.begin() + chunk);
+					reshaped = true;
+				}
+				else
+					chunk++;
+				item = 0;
+			}
+
+			// Only the chunks at either end of what was taken out can have been left small, the later one first so
+			// merging it keeps the other where it was
+			reshaped = mergeSmall(first + 1) | reshaped;
+			reshaped = mergeSmall(first) | reshaped;
+			if (reshaped) rebuildChunks();
+		}
+
+	private:
+		enum { CHUNK = 256 };
+
+		std::vector<std::vector<int>> chunks;
+		// Total of each chunk, and the trees over the chunks' totals and item counts
+		std::vector<int> sums;
+		FenwickTree totals, sizes;
+		int items = 0;
+
+		// Chunk holding an item, which becomes its place in that chunk
+		int chunkOf(int& item) const
+		{
+			int chunk = sizes.find(item);
+			item -= sizes.prefix(chunk);
+			return chunk;
+		}
+
+		// A chunk left with under half of CHUNK joins the one before it, or after it for the first, and the two are
+		// cut in half again if that makes one too big. The trees over the chunks need building again after.
+		bool mergeSmall(int chunk)
+		{
+			if (chunk >= (int)chunks.size() || chunks.size() < 2 || (int)chunks[chunk].size() >= CHUNK / 2) return false;
+
+			int keep = chunk > 0 ? chunk - 1 : chunk;
+			std::vector<int>& merged = chunks[keep];
+			const std::vector<int>& other = chunks[keep + 1];
+			merged.insert(merged.end(), other.begin(), other.end());
+			chunks.erase(chunks.begin() + keep + 1);
+			sums[keep] += sums[keep + 1];
+			sums.erase(sums.begin() + keep + 1);
+
+			if ((int)merged.size() > 2 * CHUNK)
+			{
+				std::vector<int> half(merged.begin() + merged.size() / 2, merged.end());
+				merged.resize(merged.size() / 2);
+				int halfSum = sumOf(half);
+				chunks.insert(chunks.begin() + keep + 1, std::move(half));
+				sums[keep] -= halfSum;
+				sums.insert(sums.begin() + keep + 1, halfSum);
+			}
+			return true;
+		}
+
+		static int sumOf(const std::vector<int>& counts)
+		{
+			int sum = 0;
+			for (int count : counts) sum += count;
+			return sum;
+		}
+
+		// From the kept totals, so O(chunks) and not O(items)
+		void rebuildChunks()
+		{
+			std::vector<int> counts;
+			counts.reserve(chunks.size());
+			for (const std::vector<int>& chunk : chunks) counts.push_back((int)chunk.size());
+			totals.build(sums);
+			sizes.build(counts);
+		}
+	};
+}
@@ -0,0 +1,621 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+
+#include "olcPixelGameEngine.h"
+#include "LineIndex.h"
+
+namespace Text {
+
+	// One edit of a batch: length characters at offset give way to inserted new ones. A batch is sorted by offset,
+	// its changes do not overlap and every offset is into the text as it was before any of them.
+	struct Change {
+		size_t offset, length, inserted;
+	};
+
+	// Document text as a piece table. The original text is never written to, typed text is appended to a single
+	// add buffer and the document is the list of pieces pointing into one or the other. The pieces are kept in
+	// chunks of up to a few hundred with a Fenwick tree over the chunks' lengths, so finding the piece at an offset
+	// is O(log P) to its chunk and a walk inside it, and putting a piece in or taking one out only moves the pieces
+	// after it in its chunk. Typing straight after the last insert grows the piece it made and the piece last
+	// looked up is remembered, so typing at the caret is O(1) amortised and an edit anywhere else O(log P + CHUNK).
+	// A batch splice rebuilds the pieces in one O(P + changes) pass. The text takes about one byte per character.
+	class PieceTable {
+	public:
+		enum class Source : uint8_t {
+			ORIGINAL,
+			ADD
+		};
+
+		struct Piece {
+			Source source;
+			size_t start, length;
+		};
+
+		PieceTable() {}
+
+		explicit PieceTable(std::string text)
+		{
+			std::shared_ptr<std::string> owner = std::make_shared<std::string>(std::move(text));
+			original = owner->data();
+			originalOwner = owner;
+
+			if (!owner->empty()) build({ { Source::ORIGINAL, 0, owner->size() } });
+		}
+
+		// Original text held somewhere else, such as a mapped file, kept alive by owner
+		PieceTable(const char* text, size_t length, std::shared_ptr<const void> owner) : original(text), originalOwner(std::move(owner))
+		{
+			if (length) build({ { Source::ORIGINAL, 0, length } });
+		}
+
+		size_t size() const { return total; }
+		bool empty() const { return total == 0; }
+
+		// Every piece in order, copied out of the chunks they are kept in
+		std::vector<Piece> getPieces() const
+		{
+			std::vector<Piece> all;
+			for (const std::vector<Piece>& chunk : chunks) all.insert(all.end(), chunk.begin(), chunk.end());
+			return all;
+		}
+
+		const char* pieceData(const Piece& p) const { return (p.source == Source::ORIGINAL ? original : added.data()) + p.start; }
+
+		char at(size_t offset) const
+		{
+			Place place = locate(offset);
+			return pieceData(chunks[place.chunk][place.piece])[offset - place.start];
+		}
+
+		void insert(size_t offset, const char* s, size_t n)
+		{
+			if (n == 0) return;
+
+			Place place = locate(offset);
+
+			// Straight after the last insert, the piece it made just grows, even from the end of the chunk before
+			if (offset == place.start && (place.piece > 0 || place.chunk > 0))
+			{
+				Place before = place;
+				if (before.piece == 0)
+				{
+					before.chunk--;
+					before.piece = chunks[before.chunk].size();
+					before.chunkStart -= lengths[before.chunk];
+				}
+				Piece& previous = chunks[before.chunk][--before.piece];
+				if (previous.source == Source::ADD && previous.start + previous.length == added.size())
+				{
+					added.append(s, n);
+					previous.length += n;
+					grown(before.chunk, n);
+					before.start = offset - (previous.length - n);
+					cache = before;
+					return;
+				}
+			}
+
+			Piece piece{ Source::ADD, added.size(), n };
+			added.append(s, n);
+
+			if (chunks.empty()) newChunk();
+			std::vector<Piece>& pieces = chunks[place.chunk];
+			if (offset == place.start)
+				pieces.insert(pieces.begin() + place.piece, piece);
+			else
+			{
+				// Split the piece around the new text
+				size_t head = offset - place.start;
+				Piece tail{ pieces[place.piece].source, pieces[place.piece].start + head, pieces[place.piece].length - head };
+				pieces[place.piece].length = head;
+				pieces.insert(pieces.begin() + place.piece + 1, { piece, tail });
+			}
+
+			grown(place.chunk, n);
+			cache = place;
+			cutLarge(place.chunk);
+		}
+
+		void insert(size_t offset, const std::string& s) { insert(offset, s.data(), s.size()); }
+
+		// Where the next inserted text will land in the add buffer, the piece an insert makes starts here
+		size_t addedSize() const { return added.size(); }
+
+		// The pieces covering a range. Neither buffer is ever written over, so they stay valid after the range is
+		// erased and can put the same text back with insertPieces.
+		void slice(size_t offset, size_t n, std::vector<Piece>& out) const
+		{
+			forEachPiece(offset, n, [&](const Piece& piece, size_t from, size_t count) { out.push_back({ piece.source, piece.start + from, count }); });
+		}
+
+		void insertPieces(size_t offset, const Piece* list, size_t count)
+		{
+			if (count == 0) return;
+
+			if (chunks.empty()) newChunk();
+			Place place = locate(offset);
+			std::vector<Piece>& pieces = chunks[place.chunk];
+
+			if (offset != place.start)
+			{
+				size_t head = offset - place.start;
+				Piece tail{ pieces[place.piece].source, pieces[place.piece].start + head, pieces[place.piece].length - head };
+				pieces[place.piece].length = head;
+				pieces.insert(pieces.begin() + ++place.piece, tail);
+				place.start = offset;
+			}
+
+			pieces.insert(pieces.begin() + place.piece, list, list + count);
+			size_t n = 0;
+			for (size_t k = 0; k < count; k++) n += list[k].length;
+
+			grown(place.chunk, n);
+			cache = place;
+			cutLarge(place.chunk);
+		}
+
+		// Store text in the add buffer without putting it anywhere, for a splice to place
+		Piece append(const char* s, size_t n)
+		{
+			Piece piece{ Source::ADD, added.size(), n };
+			added.append(s, n);
+			return piece;
+		}
+
+		// Apply a batch of changes, each one's inserted characters being the next pieces of list. The piece list is
+		// rebuilt in one pass, however many changes there are, and the text between them keeps its pieces.
+		void splice(const std::vector<Change>& changes, const Piece* list)
+		{
+			if (changes.empty()) return;
+
+			std::vector<Piece> result;
+			result.reserve(chunks.size() * CHUNK + changes.size() * 2);
+			size_t cursor = 0;
+			for (const Change& change : changes)
+			{
+				slice(cursor, change.offset - cursor, result);
+				for (size_t n = 0; n < change.inserted; n += (list++)->length) result.push_back(*list);
+				cursor = change.offset + change.length;
+			}
+			slice(cursor, total - cursor, result);
+
+			build(result);
+		}
+
+		void erase(size_t offset, size_t n)
+		{
+			n = std::min(n, total - std::min(offset, total));
+			if (n == 0) return;
+
+			Place place = locate(offset);
+			size_t chunk = place.chunk, i = place.piece, start = place.start;
+			bool reshaped = false;
+
+			while (n > 0)
+			{
+				std::vector<Piece>& pieces = chunks[chunk];
+				Piece& p = pieces[i];
+				size_t head = offset - start, cut = std::min(n, p.length - head);
+				n -= cut;
+				grown(chunk, 0 - cut);
+
+				if (head == 0 && cut == p.length)
+					pieces.erase(pieces.begin() + i);
+				else if (head == 0)
+				{
+					p.start += cut;
+					p.length -= cut;
+				}
+				else if (head + cut == p.length)
+				{
+					p.length = head;
+					start += head;
+					i++;
+				}
+				else
+				{
+					Piece tail{ p.source, p.start + head + cut, p.length - head - cut };
+					p.length = head;
+					pieces.insert(pieces.begin() + i + 1, tail);
+				}
+
+				// Carry on into the next chunk, dropping this one if nothing is left of it
+				if (pieces.empty())
+				{
+					chunks.erase(chunks.begin() + chunk);
+					lengths.erase(lengths.begin() + chunk);
+					reshaped = true;
+					i = 0;
+				}
+				else if (i == pieces.size())
+				{
+					chunk++;
+					i = 0;
+				}
+			}
+
+			// Only the chunks at either end of what was taken out can have been left small, the later one first so
+			// merging it keeps the other where it was
+			reshaped = mergeSmall(place.chunk + 1) | reshaped;
+			reshaped = mergeSmall(place.chunk) | reshaped;
+			if (reshaped) rebuildIndex();
+			else cache = place; // pieces before the first one touched keep their place
+		}
+
+		void copy(size_t offset, size_t n, char* out) const
+		{
+			forEachPiece(offset, n, [&](const Piece& piece, size_t from, size_t count)
+			{
+				std::copy(pieceData(piece) + from, pieceData(piece) + from + count, out);
+				out += count;
+			});
+		}
+
+		std::string substr(size_t offset, size_t n) const
+		{
+			n = std::min(n, total - std::min(offset, total));
+			std::string s(n, '\0');
+			copy(offset, n, &s[0]);
+			return s;
+		}
+
+		std::string toString() const { return substr(0, total); }
+
+	private:
+		enum { CHUNK = 256 };
+
+		const char* original = nullptr;
+		// Keeps the original text alive, whatever holds it
+		std::shared_ptr<const void> originalOwner;
+		std::string added;
+		size_t total = 0;
+
+		// Pieces in chunks of up to 2 * CHUNK, none of them empty, with the characters each covers and a tree over those
+		std::vector<std::vector<Piece>> chunks;
+		std::vector<size_t> lengths;
+		BasicFenwickTree<size_t> index;
+
+		// A piece by its chunk and place in it, with the offsets it and its chunk start at. At the very end of the
+		// text it is one past the last piece of the last chunk.
+		struct Place {
+			size_t chunk, piece, start, chunkStart;
+		};
+
+		// Last piece found, edits near the caret start looking from here
+		mutable Place cache{ 0, 0, 0, 0 };
+		mutable bool cached = false;
+
+		Place locate(size_t offset) const
+		{
+			Place place{ 0, 0, 0, 0 };
+			if (chunks.empty()) return place;
+
+			size_t last = chunks.size() - 1;
+			if (cached && cache.chunk < chunks.size() && offset >= cache.chunkStart
+				&& (offset < cache.chunkStart + lengths[cache.chunk] || (offset >= total && cache.chunk == last)))
+				place = cache;
+			else if (offset >= total)
+				place = { last, chunks[last].size(), total, total - lengths[last] };
+			else
+			{
+				place.chunk = index.find(offset);
+				place.start = place.chunkStart = index.prefix((int)place.chunk);
+			}
+
+			const std::vector<Piece>& pieces = chunks[place.chunk];
+			while (place.piece > 0 && place.start > offset) place.start -= pieces[--place.piece].length;
+			while (place.piece < pieces.size() && place.start + pieces[place.piece].length <= offset) place.start += pieces[place.piece++].length;
+
+			cache = place;
+			cached = true;
+			return place;
+		}
+
+		// Calls f with each piece overlapping a range, where in it the range starts and how much of it is covered
+		template <class Visit>
+		void forEachPiece(size_t offset, size_t n, Visit f) const
+		{
+			if (n == 0) return;
+
+			Place place = locate(offset);
+			for (size_t chunk = place.chunk, i = place.piece, start = place.start; n > 0; )
+			{
+				const Piece& piece = chunks[chunk][i];
+				size_t from = offset - start, count = std::min(n, piece.length - from);
+				f(piece, from, count);
+				offset += count;
+				n -= count;
+
+				start += piece.length;
+				if (++i == chunks[chunk].size())
+				{
+					chunk++;
+					i = 0;
+				}
+			}
+		}
+
+		void grown(size_t chunk, size_t n)
+		{
+			lengths[chunk] += n;
+			index.add((int)chunk, n);
+			total += n;
+		}
+
+		void newChunk()
+		{
+			chunks.emplace_back();
+			lengths.push_back(0);
+			rebuildIndex();
+		}
+
+		// Replace every chunk with ones cut from a whole list of pieces
+		void build(const std::vector<Piece>& all)
+		{
+			chunks.clear();
+			lengths.clear();
+			total = 0;
+			for (size_t i = 0; i < all.size(); i += CHUNK)
+			{
+				chunks.emplace_back(all.begin() + i, all.begin() + std::min(all.size(), i + CHUNK));
+				lengths.push_back(lengthOf(chunks.back()));
+				total += lengths.back();
+			}
+			rebuildIndex();
+		}
+
+		// A chunk grown past 2 * CHUNK pieces is cut into chunks of CHUNK, the last one taking what is left over
+		void cutLarge(size_t chunk)
+		{
+			if (chunks[chunk].size() <= 2 * CHUNK) return;
+
+			std::vector<Piece> whole;
+			whole.swap(chunks[chunk]);
+			std::vector<std::vector<Piece>> cut;
+			std::vector<size_t> cutLengths;
+			for (size_t i = 0; i < whole.size(); )
+			{
+				size_t end = whole.size() - i < 2 * CHUNK ? whole.size() : i + CHUNK;
+				cut.emplace_back(whole.begin() + i, whole.begin() + end);
+				cutLengths.push_back(lengthOf(cut.back()));
+				i = end;
+			}
+			chunks.erase(chunks.begin() + chunk);
+			chunks.insert(chunks.begin() + chunk, cut.begin(), cut.end());
+			lengths.erase(lengths.begin() + chunk);
+			lengths.insert(lengths.begin() + chunk, cutLengths.begin(), cutLengths.end());
+			rebuildIndex();
+		}
+
+		// A chunk left with under half of CHUNK pieces joins the one before it, or after it for the first, and the
+		// two are cut in half again if that makes one too big. The index needs building again after.
+		bool mergeSmall(size_t chunk)
+		{
+			if (chunk >= chunks.size() || chunks.size() < 2 || chunks[chunk].size() >= CHUNK / 2) return false;
+
+			size_t keep = chunk > 0 ? chunk - 1 : chunk;
+			std::vector<Piece>& merged = chunks[keep];
+			const std::vector<Piece>& other = chunks[keep + 1];
+			merged.insert(merged.end(), other.begin(), other.end());
+			chunks.erase(chunks.begin() + keep + 1);
+			lengths[keep] += lengths[keep + 1];
+			lengths.erase(lengths.begin() + keep + 1);
+
+			if (merged.size() > 2 * CHUNK)
+			{
+				std::vector<Piece> half(merged.begin() + merged.size() / 2, merged.end());
+				merged.resize(merged.size() / 2);
+				size_t halfLength = lengthOf(half);
+				chunks.insert(chunks.begin() + keep + 1, std::move(half));
+				lengths[keep] -= halfLength;
+				lengths.insert(lengths.begin() + keep + 1, halfLength);
+			}
+			return true;
+		}
+
+		static size_t lengthOf(const std::vector<Piece>& pieces)
+		{
+			size_t length = 0;
+			for (const Piece& piece : pieces) length += piece.length;
+			return length;
+		}
+
+		// O(chunks), from the kept lengths. Places found before are no longer any use.
+		void rebuildIndex()
+		{
+			index.build(lengths);
+			cached = false;
+		}
+	};
+
+	struct Style {
+		olc::Pixel color = olc::WHITE;
+		bool bold = false, italics = false, underscore = false;
+
+		bool operator==(const Style& o) const { return color == o.color && bold == o.bold && italics == o.italics && underscore == o.underscore; }
+		bool operator!=(const Style& o) const { return !(*this == o); }
+	};
+
+	// Character styles as runs, one per stretch of identically styled text. Typed text takes the style of the
+	// character before it.
+	class StyleRuns {
+	public:
+		struct Run {
+			size_t length;
+			Style style;
+		};
+
+		const std::vector<Run>& getRuns() const { return runs; }
+
+		const Style& at(size_t offset) const
+		{
+			static const Style plain;
+			size_t start;
+			size_t i = locate(offset, start);
+			return i < runs.size() ? runs[i].style : plain;
+		}
+
+		// Index of the run holding offset and the offset it starts at, as PieceTable::locate
+		size_t locate(size_t offset, size_t& runStart) const
+		{
+			size_t i = cacheIndex, start = cacheStart;
+
+			while (i > 0 && start > offset) start -= runs[--i].length;
+			while (i < runs.size() && start + runs[i].length <= offset) start += runs[i++].length;
+
+			cacheIndex = i;
+			cacheStart = start;
+			runStart = start;
+			return i;
+		}
+
+		void insert(size_t offset, size_t n)
+		{
+			if (n == 0) return;
+			if (runs.empty())
+			{
+				runs.push_back({ n, Style() });
+				return;
+			}
+
+			size_t start;
+			size_t i = locate(offset == 0 ? 0 : offset - 1, start);
+			if (i == runs.size()) { i--; start -= runs[i].length; }
+
+			runs[i].length += n;
+			cacheIndex = i;
+			cacheStart = start;
+		}
+
+		void erase(size_t offset, size_t n)
+		{
+			size_t start;
+			size_t i = locate(offset, start);
+
+			while (n > 0 && i < runs.size())
+			{
+				size_t cut = std::min(n, runs[i].length - (offset - start));
+				runs[i].length -= cut;
+				n -= cut;
+
+				if (runs[i].length == 0)
+					runs.erase(runs.begin() + i);
+				else
+				{
+					start += runs[i].length;
+					i++;
+				}
+			}
+
+			mergeAround(i);
+		}
+
+		void apply(size_t offset, size_t n, const Style& style)
+		{
+			if (n == 0) return;
+
+			size_t first = split(offset), last = split(offset + n);
+			for (size_t i = first; i < last; i++) runs[i].style = style;
+
+			mergeAround(last);
+			mergeAround(first);
+		}
+
+		// Apply a batch of changes in one pass over the runs. Inserted text takes the style of the character before
+		// it, as typing does.
+		void splice(const std::vector<Change>& changes)
+		{
+			if (changes.empty()) return;
+
+			std::vector<Run> result;
+			result.reserve(runs.size() + changes.size());
+			auto add = [&](size_t n, const Style& style)
+			{
+				if (!result.empty() && result.back().style == style) result.back().length += n;
+				else if (n) result.push_back({ n, style });
+			};
+
+			// Copies runs from cursor up to an offset, or skips them
+			size_t i = 0, start = 0, cursor = 0;
+			auto advance = [&](size_t offset, bool copy)
+			{
+				while (cursor < offset && i < runs.size())
+				{
+					size_t end = std::min(offset, start + runs[i].length);
+					if (copy) add(end - cursor, runs[i].style);
+					cursor = end;
+					if (end == start + runs[i].length) start += runs[i++].length;
+				}
+			};
+
+			for (const Change& change : changes)
+			{
+				advance(change.offset, true);
+				advance(change.offset + change.length, false);
+				if (change.inserted) add(change.inserted, !result.empty() ? result.back().style : i < runs.size() ? runs[i].style : Style());
+			}
+			advance((size_t)-1, true);
+
+			runs.swap(result);
+			cacheIndex = 0;
+			cacheStart = 0;
+		}
+
+		// Replace the styles of n characters from offset with a list of runs covering exactly n characters, such as
+		// the tokens of a highlighted line, in one splice
+		void assign(size_t offset, size_t n, const Run* list, size_t count)
+		{
+			if (n == 0) return;
+
+			size_t first = split(offset), last = split(offset + n);
+			runs.erase(runs.begin() + first, runs.begin() + last);
+			runs.insert(runs.begin() + first, list, list + count);
+			cacheIndex = first;
+			cacheStart = offset;
+
+			mergeAround(first + count);
+			mergeAround(first);
+		}
+
+	private:
+		std::vector<Run> runs;
+		mutable size_t cacheIndex = 0, cacheStart = 0;
+
+		// Makes a run start at offset, returns its index
+		size_t split(size_t offset)
+		{
+			size_t start;
+			size_t i = locate(offset, start);
+			if (i == runs.size() || offset == start) return i;
+
+			Run tail{ start + runs[i].length - offset, runs[i].style };
+			runs[i].length = offset - start;
+			runs.insert(runs.begin() + i + 1, tail);
+			return i + 1;
+		}
+
+		// Joins run i with its neighbours where the styles match
+		void mergeAround(size_t i)
+		{
+			if (i < runs.size() && i + 1 < runs.size() && runs[i].style == runs[i + 1].style)
+				joinNext(i);
+			if (i > 0 && i < runs.size() && runs[i - 1].style == runs[i].style)
+				joinNext(i - 1);
+		}
+
+		// Fold run i + 1 into run i, keeping the remembered run pointing at the same text
+		void joinNext(size_t i)
+		{
+			if (cacheIndex == i + 1) cacheStart -= runs[i].length;
+			if (cacheIndex > i) cacheIndex--;
+
+			runs[i].length += runs[i + 1].length;
+			runs.erase(runs.begin() + i + 1);
+		}
+	};
+}
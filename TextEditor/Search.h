@@ -0,0 +1,217 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXT_SEARCH_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "PieceTable.h"
+
+namespace Text {
+
+	// Index of the lowest set bit, v must not be zero
+	inline int lowestBit(uint32_t v)
+	{
+#if defined(_MSC_VER)
+		unsigned long bit;
+		_BitScanForward(&bit, v);
+		return (int)bit;
+#elif defined(__GNUC__)
+		return __builtin_ctz(v);
+#else
+		int bit = 0;
+		while (!(v & 1)) { v >>= 1; bit++; }
+		return bit;
+#endif
+	}
+
+	// Boyer-Moore-Horspool, used where SSE2 is not available
+	inline const char* findBytesHorspool(const char* first, const char* last, const char* needle, size_t n)
+	{
+		size_t shift[256];
+		std::fill(shift, shift + 256, n);
+		for (size_t i = 0; i + 1 < n; i++) shift[(uint8_t)needle[i]] = n - 1 - i;
+
+		for (const char* p = first; p + n <= last; p += shift[(uint8_t)p[n - 1]])
+			if (p[n - 1] == needle[n - 1] && memcmp(p, needle, n - 1) == 0)
+				return p;
+		return nullptr;
+	}
+
+	// First occurrence of the needle in [first, last). With SSE2, sixteen starting positions at a time are kept
+	// only where both the first and the last byte of the needle match, and only those are compared in full.
+	inline const char* findBytes(const char* first, const char* last, const char* needle, size_t n)
+	{
+		if (n == 0) return first;
+		if (last - first < (ptrdiff_t)n) return nullptr;
+		if (n == 1) return (const char*)memchr(first, needle[0], last - first);
+
+#ifdef TEXT_SEARCH_SSE2
+		const __m128i head = _mm_set1_epi8(needle[0]), tail = _mm_set1_epi8(needle[n - 1]);
+		// Every start before stop leaves room for the whole needle
+		const char* stop = last - n + 1;
+		const char* p = first;
+
+		for (; p + 16 <= stop; p += 16)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)p), b = _mm_loadu_si128((const __m128i*)(p + n - 1));
+			uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, head), _mm_cmpeq_epi8(b, tail)));
+
+			for (; mask; mask &= mask - 1)
+			{
+				int i = lowestBit(mask);
+				if (memcmp(p + i + 1, needle + 1, n - 2) == 0) return p + i;
+			}
+		}
+
+		for (; p < stop; p++)
+			if (p[0] == needle[0] && p[n - 1] == needle[n - 1] && memcmp(p + 1, needle + 1, n - 2) == 0)
+				return p;
+		return nullptr;
+#else
+		return findBytesHorspool(first, last, needle, n);
+#endif
+	}
+
+	// Finds text in a piece table. The pieces are flattened into spans first so the searching threads only read
+	// plain memory, and a match that runs over the end of a span is found by copying the few bytes either side
+	// of the join into a small window.
+	class Searcher {
+	public:
+		static const size_t npos = ~(size_t)0;
+
+		// Documents smaller than this are searched on one thread
+		size_t minChunk = 1 << 20;
+
+		explicit Searcher(const PieceTable& text)
+		{
+			size_t offset = 0;
+			for (const PieceTable::Piece& piece : text.getPieces())
+			{
+				spans.push_back({ offset, text.pieceData(piece), piece.length });
+				offset += piece.length;
+			}
+			total = offset;
+		}
+
+		// First match starting at or after from
+		size_t find(const std::string& needle, size_t from = 0) const
+		{
+			std::vector<size_t> found;
+			if (!needle.empty()) searchRange(needle, from, total, found, 1);
+			return found.empty() ? npos : found[0];
+		}
+
+		// Every match in order, overlapping ones included. Large documents are cut into one chunk per thread, each
+		// thread keeps the matches starting in its chunk and the lists are joined in chunk order.
+		std::vector<size_t> findAll(const std::string& needle, int threads = 0) const
+		{
+			std::vector<size_t> found;
+			if (needle.empty()) return found;
+
+			if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+			size_t chunks = std::max<size_t>(1, std::min<size_t>(threads, total / minChunk));
+
+			if (chunks == 1)
+			{
+				searchRange(needle, 0, total, found, npos);
+				return found;
+			}
+
+			std::vector<std::vector<size_t>> results(chunks);
+			std::vector<std::thread> workers;
+			for (size_t c = 0; c < chunks; c++)
+				workers.emplace_back([&, c]() { searchRange(needle, total * c / chunks, total * (c + 1) / chunks, results[c], npos); });
+
+			for (size_t c = 0; c < chunks; c++)
+			{
+				workers[c].join();
+				found.insert(found.end(), results[c].begin(), results[c].end());
+			}
+			return found;
+		}
+
+		// Drop matches that overlap an earlier kept one, as a replacement would see them
+		static std::vector<size_t> nonOverlapping(const std::vector<size_t>& matches, size_t length)
+		{
+			std::vector<size_t> kept;
+			for (size_t m : matches)
+				if (kept.empty() || m >= kept.back() + length)
+					kept.push_back(m);
+			return kept;
+		}
+
+	private:
+		struct Span {
+			size_t offset;
+			const char* data;
+			size_t length;
+		};
+
+		std::vector<Span> spans;
+		size_t total = 0;
+
+		// Matches starting in [from, to), stopping once there are limit of them
+		void searchRange(const std::string& needle, size_t from, size_t to, std::vector<size_t>& out, size_t limit) const
+		{
+			size_t n = needle.size();
+			std::vector<char> window;
+
+			// The span holding from
+			size_t i = std::upper_bound(spans.begin(), spans.end(), from, [](size_t offset, const Span& s) { return offset < s.offset; }) - spans.begin();
+			i = i > 0 ? i - 1 : 0;
+
+			for (; i < spans.size() && spans[i].offset < to; i++)
+			{
+				const Span& s = spans[i];
+				size_t begin = std::max(from, s.offset), end = s.offset + s.length;
+
+				// Whole matches inside the span
+				const char* last = s.data + std::min(s.length, std::min(to, end) - s.offset + n - 1);
+				for (const char* p = s.data + (begin - s.offset); (p = findBytes(p, last, needle.data(), n)); p++)
+				{
+					out.push_back(s.offset + (p - s.data));
+					if (out.size() >= limit) return;
+				}
+
+				// Matches starting in this span and ending in a later one
+				size_t windowStart = std::max(begin, end - std::min(end, n - 1)), windowEnd = std::min(total, end + n - 1);
+				if (i + 1 == spans.size() || windowStart >= std::min(to, end)) continue;
+
+				window.resize(windowEnd - windowStart);
+				copy(i, windowStart, window.size(), window.data());
+
+				const char* w = window.data();
+				for (const char* p = w; (p = findBytes(p, w + window.size(), needle.data(), n)) && windowStart + (p - w) < std::min(to, end); p++)
+				{
+					out.push_back(windowStart + (p - w));
+					if (out.size() >= limit) return;
+				}
+			}
+		}
+
+		// Copy bytes from span i onward
+		void copy(size_t i, size_t offset, size_t n, char* out) const
+		{
+			for (; n > 0; i++)
+			{
+				size_t from = offset - spans[i].offset, count = std::min(n, spans[i].length - from);
+				memcpy(out, spans[i].data + from, count);
+				out += count;
+				offset += count;
+				n -= count;
+			}
+		}
+	};
+}
@@ -0,0 +1,1664 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#define UTIL_TEXT_FILE
+#include "olcUtility.h"
+#include "PieceTable.h"
+#include "LineIndex.h"
+#include "Undo.h"
+#include "Search.h"
+#include "Autosave.h"
+#include "Highlight.h"
+#include "Utf8.h"
+
+#define TAB_SIZE 3
+#define LINE_WIDTH 32
+#define PARAGRAPH '\n'
+// Most bytes read for one row, enough for LINE_WIDTH graphemes of several code points each
+#define WRAP_WINDOW ((LINE_WIDTH + 1) * 16)
+
+// Characters typed by each key, without and with shift, indexed by olc::Key. Zero for keys that type nothing.
+struct KeyCharTable {
+	char plain[olc::ENUM_END + 1], shifted[olc::ENUM_END + 1];
+};
+
+constexpr KeyCharTable MakeKeyCharTable()
+{
+	KeyCharTable table{};
+
+	for (int i = 0; i < 26; i++)
+	{
+		table.plain[olc::A + i] = (char)('a' + i);
+		table.shifted[olc::A + i] = (char)('A' + i);
+	}
+
+	const char* digits = "0123456789", *shiftedDigits = ")!@#$%^&*(";
+	for (int i = 0; i < 10; i++)
+	{
+		table.plain[olc::K0 + i] = digits[i];
+		table.shifted[olc::K0 + i] = shiftedDigits[i];
+		table.plain[olc::NP0 + i] = table.shifted[olc::NP0 + i] = digits[i];
+	}
+
+	// The other keys that type something, with their characters in the same order
+	const olc::Key others[] = { olc::SPACE, olc::TAB, olc::RETURN, olc::ENTER, olc::NP_MUL, olc::NP_DIV, olc::NP_ADD, olc::NP_SUB, olc::NP_DECIMAL,
+		olc::PERIOD, olc::EQUALS, olc::COMMA, olc::MINUS, olc::OEM_1, olc::OEM_2, olc::OEM_3, olc::OEM_4, olc::OEM_5, olc::OEM_6, olc::OEM_7 };
+	const char* plain = " \t\n\n*/+-..=,-;/`[\\]'", *shifted = " \t\n\n*/+-.>+<_:?~{|}\"";
+	for (int i = 0; i < (int)(sizeof(others) / sizeof(others[0])); i++)
+	{
+		table.plain[others[i]] = plain[i];
+		table.shifted[others[i]] = shifted[i];
+	}
+	return table;
+}
+
+constexpr KeyCharTable KeyChars = MakeKeyCharTable();
+
+// Override base class with your custom functionality
+class TextEditor : public olc::PixelGameEngine
+{
+public:
+	TextEditor()
+	{
+		// Name your application
+		sAppName = "Macrosoft Letters";
+	}
+
+	static void Log(std::string msg)
+	{
+		std::cout << msg << std::endl;
+	}
+
+	static void Log(char msg)
+	{
+		std::cout << msg << std::endl;
+	}
+
+	static void Log(int msg)
+	{
+		std::cout << msg << std::endl;
+	}
+
+	enum eTextAlignment {
+		LEFT,
+		RIGHT,
+		CENTER,
+		JUSTIFIED
+	};
+
+	// One row of a paragraph on screen, start and length count bytes of UTF-8 from the paragraph's start. Each
+	// grapheme takes one 8 pixel column.
+	struct Line {
+		int start, length;
+		int maxCharHeight;
+		// Set by the paragraph's alignment: where the row starts and the extra width of each space when justified
+		float x = 0.0f, stretch = 0.0f;
+		// Graphemes on the row, as many as its bytes while it is all ASCII
+		int columns;
+
+		Line(int _start = 0, int _length = 0, int _columns = -1) : start(_start), length(_length), maxCharHeight(8), columns(_columns < 0 ? _length : _columns) {  }
+
+		int Columns() const { return columns; }
+
+		// Byte a column starts at, the row starts at lineStart in the text
+		int ByteOf(const Text::PieceTable& text, size_t lineStart, int column) const
+		{
+			column = std::min(column, columns);
+			return columns == length ? column : Index(text, lineStart)[column];
+		}
+
+		// Column starting at or after a byte of the row, a byte inside a grapheme goes to the end of it
+		int ColumnOf(const Text::PieceTable& text, size_t lineStart, int byte) const
+		{
+			if (columns == length) return std::min(byte, length);
+			return ColumnIn(Index(text, lineStart), byte);
+		}
+
+		// The row as drawn, one character per column. The font only has ASCII, anything else shows as a '?'.
+		std::string Shown(const std::string& chars, const std::vector<int>& index) const
+		{
+			if (columns == length) return chars;
+
+			std::string shown(columns, '?');
+			for (int c = 0; c < columns; c++)
+				if ((uint8_t)chars[index[c]] < 0x80) shown[c] = chars[index[c]];
+			return shown;
+		}
+
+		std::string Shown(const Text::PieceTable& text, size_t lineStart) const
+		{
+			std::string chars = text.substr(lineStart, length);
+			return Shown(chars, columns == length ? std::vector<int>() : Index(chars));
+		}
+
+		// Screen x of a column, chars holds the row as shown up to it
+		float CharX(const char* chars, int ind) const
+		{
+			float pos = x + ind * 8.0f;
+			if (stretch > 0.0f) pos += stretch * std::count(chars, chars + ind, ' ');
+			return pos;
+		}
+
+		// Adds one string per stretch of identically styled text, usually the whole line, to the frame's glyph batch.
+		// Justified rows are cut at their spaces as well so each word can move.
+		void DrawLine(util::GlyphBatch& glyphs, const Text::PieceTable& text, const Text::StyleRuns& styles, size_t lineStart, int lineYPos)
+		{
+			if (length == 0) return;
+
+			std::string bytes = text.substr(lineStart, length);
+			std::vector<int> index = columns == length ? std::vector<int>() : Index(bytes);
+			std::string chars = Shown(bytes, index);
+			const std::vector<Text::StyleRuns::Run>& runs = styles.getRuns();
+
+			// Runs are in bytes, drawing goes by column
+			size_t runStart;
+			size_t run = styles.locate(lineStart, runStart);
+			for (int drawn = 0; drawn < Columns() && run < runs.size(); runStart += runs[run++].length)
+			{
+				int runEnd = (int)std::min<size_t>(length, runStart + runs[run].length - lineStart);
+				if (columns != length) runEnd = ColumnIn(index, runEnd);
+				while (drawn < runEnd)
+				{
+					int count = runEnd - drawn;
+					if (stretch > 0.0f)
+					{
+						const char* space = (const char*)memchr(chars.data() + drawn, ' ', count);
+						if (space) count = (int)(space - chars.data()) - drawn + 1;
+					}
+
+					glyphs.addString(olc::vf2d{ CharX(chars.data(), drawn), (float)lineYPos }, chars.data() + drawn, count, runs[run].style.color);
+					drawn += count;
+				}
+			}
+		}
+
+	private:
+		// Byte each column starts at and the byte the row ends at, only worked out for rows that are not all ASCII.
+		// Rows on the screen are few, so it is not kept.
+		std::vector<int> Index(const std::string& chars) const
+		{
+			std::vector<int> index;
+			index.reserve(columns + 1);
+			for (size_t i = 0; i < chars.size(); i = Text::nextGrapheme(chars.data(), chars.size(), i))
+				index.push_back((int)i);
+			index.push_back(length);
+			return index;
+		}
+
+		std::vector<int> Index(const Text::PieceTable& text, size_t lineStart) const { return Index(text.substr(lineStart, length)); }
+
+		static int ColumnIn(const std::vector<int>& index, int byte)
+		{
+			return (int)(std::lower_bound(index.begin(), index.end(), byte) - index.begin());
+		}
+	};
+
+	// Text between two breaks, its characters live in the document's piece table
+	struct Paragraph {
+		std::vector<Line> lines{ Line() };
+		eTextAlignment alignment{eTextAlignment::LEFT};
+		olc::vi2d rootPos{0, 0};
+		int indentLevel{0}, spacing{0};
+		bool singleIndent{false}, spaceBef{false}, spaceAft{false};
+		// Characters, not counting the break that ends it
+		int length{0};
+
+		Paragraph() {}
+		Paragraph(olc::vi2d pos) : rootPos(pos) {}
+
+		// Word wrap the whole paragraph, which starts at paragraphStart in the text
+		void Reflow(const Text::PieceTable& text, size_t paragraphStart)
+		{
+			std::vector<Line> redone;
+			Wrap(text, paragraphStart, 0, redone, lines.size(), INT_MAX, 0);
+			lines.swap(redone);
+		}
+
+		// Re-wrap after removed characters at ind were replaced by added ones. Greedy wrapping makes a row depend only
+		// on where it starts, so rows are redone from the one before the edit until one starts where an old row did
+		// past the edit, the rows after that just move by the difference.
+		void Reflow(const Text::PieceTable& text, size_t paragraphStart, int ind, int removed, int added)
+		{
+			int first = std::max(0, LineOf(ind) - 1), delta = added - removed;
+			std::vector<Line> redone;
+			size_t kept = Wrap(text, paragraphStart, lines[first].start, redone, first + 1, ind + added, delta);
+
+			for (size_t i = kept; i < lines.size(); i++) lines[i].start += delta;
+
+			// Overwrite the redone rows in place, only a change in their number moves the rows after them
+			size_t replaced = kept - first, common = std::min(replaced, redone.size());
+			std::move(redone.begin(), redone.begin() + common, lines.begin() + first);
+			if (redone.size() < replaced)
+				lines.erase(lines.begin() + first + common, lines.begin() + kept);
+			else
+				lines.insert(lines.begin() + kept, std::make_move_iterator(redone.begin() + common), std::make_move_iterator(redone.end()));
+		}
+
+		// Re-wrap everything from the row before ind, for when all the text after ind is new to the paragraph
+		void ReflowFrom(const Text::PieceTable& text, size_t paragraphStart, int ind)
+		{
+			int first = std::max(0, LineOf(ind) - 1);
+			std::vector<Line> redone;
+			Wrap(text, paragraphStart, lines[first].start, redone, lines.size(), INT_MAX, 0);
+			lines.resize(first);
+			lines.insert(lines.end(), std::make_move_iterator(redone.begin()), std::make_move_iterator(redone.end()));
+		}
+
+		// Row holding a character of the paragraph
+		int LineOf(int ind)
+		{
+			int first = 0, last = Size() - 1;
+			while (first < last)
+			{
+				int mid = (first + last + 1) / 2;
+				if (lines[mid].start <= ind) first = mid;
+				else last = mid - 1;
+			}
+			return first;
+		}
+
+		int Size()
+		{
+			return lines.size();
+		}
+
+	private:
+		// Rows of at most LINE_WIDTH columns from start on, each broken after the last space that fits or mid word
+		// when a word is longer than a row. A space broken on when the row is already full belongs to no row, and a
+		// full last row is followed by an empty one for the caret. Past editEnd a new row starting where an old one
+		// from lines[oldFrom] on did, moved by delta, ends the wrap: returns that old row, or lines.size() if none.
+		// Rows of plain ASCII are measured in bytes, only the others are split into graphemes.
+		size_t Wrap(const Text::PieceTable& text, size_t paragraphStart, int start, std::vector<Line>& out, size_t oldFrom, int editEnd, int delta)
+		{
+			char chars[WRAP_WINDOW];
+			int bound[LINE_WIDTH + 2];
+			size_t k = oldFrom;
+
+			while (true)
+			{
+				int remaining = length - start;
+				int window = std::min(remaining, LINE_WIDTH + 1), columns = window;
+				text.copy(paragraphStart + start, window, chars);
+
+				bool ascii = Text::isAscii(chars, window);
+				if (!ascii) columns = Graphemes(text, paragraphStart + start, remaining, chars, window, bound);
+				auto byteOf = [&](int column) { return ascii ? column : bound[column]; };
+
+				if (columns <= LINE_WIDTH && byteOf(columns) == remaining)
+				{
+					AddLine(out, Line(start, remaining, columns), chars, true);
+					if (columns == LINE_WIDTH) AddLine(out, Line(length, 0), chars, true);
+					return lines.size();
+				}
+
+				// One past a full row, unless the window ran out on a very long cluster first
+				int full = std::min(columns, LINE_WIDTH), space = columns > LINE_WIDTH ? LINE_WIDTH : full - 1;
+				while (space > 0 && chars[byteOf(space)] != ' ') space--;
+				int next = start + byteOf(space > 0 ? space + 1 : full);
+				int bytes = std::min(next - start, byteOf(full));
+				int rowColumns = ascii ? bytes : (int)(std::lower_bound(bound, bound + full, bytes) - bound);
+				AddLine(out, Line(start, bytes, rowColumns), chars, false);
+				start = next;
+
+				if (start > editEnd)
+				{
+					while (k < lines.size() && lines[k].start < start - delta) k++;
+					if (k < lines.size() && lines[k].start == start - delta) return k;
+				}
+			}
+		}
+
+		// Grapheme bounds for the row at offset, reading on past the window until there are enough for a full row.
+		// Text that is not ASCII is mostly two or three bytes a character, so the window starts four times wider.
+		int Graphemes(const Text::PieceTable& text, size_t offset, int remaining, char* chars, int& window, int* bound)
+		{
+			int wide = std::min(remaining, window * 4);
+			text.copy(offset + window, wide - window, chars + window);
+			window = wide;
+
+			while (true)
+			{
+				int columns = Text::graphemeBounds(chars, window, LINE_WIDTH + 1, bound);
+				if (columns > LINE_WIDTH || window == remaining || window == WRAP_WINDOW) return columns;
+
+				int grown = std::min(remaining, std::min(window * 4, WRAP_WINDOW));
+				text.copy(offset + window, grown - window, chars + window);
+				window = grown;
+			}
+		}
+
+		// Place a row by the paragraph's alignment, trailing spaces take no room
+		void AddLine(std::vector<Line>& out, Line line, const char* chars, bool last)
+		{
+			int trailing = 0;
+			while (trailing < line.length && chars[line.length - 1 - trailing] == ' ') trailing++;
+			int visible = line.length - trailing;
+			int spare = LINE_WIDTH - (line.Columns() - trailing);
+
+			line.x = alignment == RIGHT ? spare * 8.0f : alignment == CENTER ? spare * 4.0f : 0.0f;
+			if (alignment == JUSTIFIED && !last)
+			{
+				int gaps = (int)std::count(chars, chars + visible, ' ');
+				if (gaps) line.stretch = spare * 8.0f / gaps;
+			}
+
+			out.push_back(std::move(line));
+		}
+	};
+
+	struct CharPos {
+		int PAGE, PARA, LINE, CHAR;
+
+		CharPos(int page, int paragraph, int line, int character) : PAGE{ page }, PARA{ paragraph }, LINE{ line }, CHAR { character } {}
+	};
+
+	struct Page {
+		std::vector<Paragraph*> paragraphs;
+		// margines
+		// Page color
+		// Header/footer
+
+		// Lines and characters (with the break) of each paragraph, kept in step as paragraphs change, come and go.
+		// Only built from scratch after every paragraph is replaced.
+		Text::CountIndex lineIndex, charIndex;
+		bool indexStale = true;
+
+		Page() { paragraphs.push_back(new Paragraph()); }
+
+		// Draw count lines from firstLine down, walking on from one lookup so the cost follows the screen size
+		void DrawLines(util::GlyphBatch& glyphs, const Text::PieceTable& text, const Text::StyleRuns& styles, size_t pageStart, int firstLine, int count)
+		{
+			if (firstLine >= GetLineNum()) return;
+
+			CharPos pos = GetLinePos(firstLine);
+			size_t paragraphStart = pageStart + ParagraphStart(pos.PARA);
+
+			for (int row = 0; row < count && pos.PARA < (int)paragraphs.size(); row++)
+			{
+				Paragraph* p = paragraphs[pos.PARA];
+				p->lines[pos.LINE].DrawLine(glyphs, text, styles, paragraphStart + p->lines[pos.LINE].start, row * 8);
+
+				if (++pos.LINE == p->Size())
+				{
+					paragraphStart += p->length + 1;
+					pos.LINE = 0;
+					pos.PARA++;
+				}
+			}
+		}
+
+		void UpdateIndex()
+		{
+			if (!indexStale) return;
+
+			std::vector<int> lines, chars;
+			for (Paragraph* p : paragraphs)
+			{
+				lines.push_back(p->Size());
+				chars.push_back(p->length + 1);
+			}
+
+			lineIndex.build(lines);
+			charIndex.build(chars);
+			indexStale = false;
+		}
+
+		CharPos GetLinePos(int ind)
+		{
+			UpdateIndex();
+			int paragraphInd = lineIndex.find(ind);
+			return CharPos{-1, paragraphInd, ind - lineIndex.prefix(paragraphInd), -1};
+		}
+
+		Line* GetLinePtr(int ind)
+		{
+			CharPos pos = GetLinePos(ind);
+			return &paragraphs[pos.PARA]->lines[pos.LINE];
+		}
+
+		Paragraph* GetParagraphPtr(int lineInd)
+		{
+			CharPos pos = GetLinePos(lineInd);
+			return paragraphs[pos.PARA];
+		}
+
+		int GetLineNum()
+		{
+			UpdateIndex();
+			return lineIndex.total();
+		}
+
+		// Offset of a paragraph's first character from the start of the page, each break is one character
+		int ParagraphStart(int para)
+		{
+			UpdateIndex();
+			return charIndex.prefix(para);
+		}
+
+		// Index of the first line of a paragraph
+		int FirstLine(int para)
+		{
+			UpdateIndex();
+			return lineIndex.prefix(para);
+		}
+
+		// Characters on the page, breaks included
+		int Length()
+		{
+			UpdateIndex();
+			return charIndex.total() - 1;
+		}
+
+		// Paragraph, page wide line and column of an offset into the page, which starts at pageStart in the text
+		CharPos OffsetToPos(const Text::PieceTable& text, size_t pageStart, int offset)
+		{
+			UpdateIndex();
+			int para = std::min(charIndex.find(offset), (int)paragraphs.size() - 1);
+			offset -= charIndex.prefix(para);
+
+			int line = paragraphs[para]->LineOf(offset);
+			const Line& row = paragraphs[para]->lines[line];
+			return CharPos{-1, para, FirstLine(para) + line, row.ColumnOf(text, pageStart + charIndex.prefix(para) + row.start, offset - row.start)};
+		}
+
+		// Grow or shrink a paragraph after removed characters at ind inside it were replaced by added ones, keeping
+		// the index current. The paragraph starts at paragraphStart in the text, which already holds the edit.
+		void ResizeParagraph(const Text::PieceTable& text, size_t paragraphStart, int para, int ind, int removed, int added)
+		{
+			Paragraph* p = paragraphs[para];
+			int oldLines = p->Size(), delta = added - removed;
+
+			p->length += delta;
+			p->Reflow(text, paragraphStart, ind, removed, added);
+
+			if (!indexStale)
+			{
+				lineIndex.add(para, p->Size() - oldLines);
+				charIndex.add(para, delta);
+			}
+		}
+
+		// Put count paragraphs just added at para into the index, and take out ones just removed
+		void IndexInserted(int para, int count)
+		{
+			if (indexStale) return;
+
+			std::vector<int> lines, chars;
+			for (int i = para; i < para + count; i++)
+			{
+				lines.push_back(paragraphs[i]->Size());
+				chars.push_back(paragraphs[i]->length + 1);
+			}
+			lineIndex.insert(para, lines.data(), count);
+			charIndex.insert(para, chars.data(), count);
+		}
+
+		void IndexErased(int para, int count)
+		{
+			if (indexStale) return;
+
+			lineIndex.erase(para, count);
+			charIndex.erase(para, count);
+		}
+
+		// Paragraph holding an offset into the page, a break belongs to the paragraph it ends
+		int ParagraphAt(int offset)
+		{
+			UpdateIndex();
+			return std::min(charIndex.find(offset), (int)paragraphs.size() - 1);
+		}
+
+		// Fit text just inserted at offset into the paragraphs, each break in it starts a new one
+		void InsertText(const Text::PieceTable& text, size_t pageStart, int offset, const std::string& s)
+		{
+			int para = ParagraphAt(offset), ind = offset - ParagraphStart(para);
+			size_t firstBreak = s.find(PARAGRAPH);
+			if (firstBreak == std::string::npos)
+			{
+				ResizeParagraph(text, pageStart + ParagraphStart(para), para, ind, 0, (int)s.size());
+				return;
+			}
+
+			// The paragraph keeps what came before the edit, its tail goes to the last new one
+			Paragraph* p = paragraphs[para];
+			int tail = p->length - ind, oldLines = p->Size(), oldLength = p->length;
+			size_t start = pageStart + ParagraphStart(para);
+			p->length = ind + (int)firstBreak;
+			p->ReflowFrom(text, start, ind);
+			start += p->length + 1;
+
+			std::vector<Paragraph*> added;
+			for (size_t from = firstBreak + 1; ; )
+			{
+				size_t end = s.find(PARAGRAPH, from);
+				Paragraph* next = new Paragraph();
+				next->alignment = p->alignment;
+				next->length = (int)((end == std::string::npos ? s.size() : end) - from);
+				if (end == std::string::npos) next->length += tail;
+				next->Reflow(text, start);
+				added.push_back(next);
+				start += next->length + 1;
+
+				if (end == std::string::npos) break;
+				from = end + 1;
+			}
+
+			paragraphs.insert(paragraphs.begin() + para + 1, added.begin(), added.end());
+			if (!indexStale)
+			{
+				lineIndex.add(para, p->Size() - oldLines);
+				charIndex.add(para, p->length - oldLength);
+			}
+			IndexInserted(para + 1, (int)added.size());
+		}
+
+		// Take n characters starting at offset out of the paragraphs, the text has already lost them
+		void EraseText(const Text::PieceTable& text, size_t pageStart, int offset, int n)
+		{
+			int first = ParagraphAt(offset), last = ParagraphAt(offset + n);
+			int head = offset - ParagraphStart(first);
+			if (first == last)
+			{
+				ResizeParagraph(text, pageStart + ParagraphStart(first), first, head, n, 0);
+				return;
+			}
+
+			// The first paragraph keeps its head and takes the last one's tail
+			Paragraph* p = paragraphs[first];
+			int tail = paragraphs[last]->length - (offset + n - ParagraphStart(last));
+			int oldLines = p->Size(), oldLength = p->length;
+			p->length = head + tail;
+			p->ReflowFrom(text, pageStart + ParagraphStart(first), head);
+
+			for (int i = first + 1; i <= last; i++) delete paragraphs[i];
+			paragraphs.erase(paragraphs.begin() + first + 1, paragraphs.begin() + last + 1);
+			if (!indexStale)
+			{
+				lineIndex.add(first, p->Size() - oldLines);
+				charIndex.add(first, p->length - oldLength);
+			}
+			IndexErased(first + 1, last - first);
+		}
+
+		// Fit a batch of changes into the paragraphs, the text already holds them all. The changes are taken in runs
+		// that reach into the same paragraphs, last run first, so the index still finds the paragraphs before by their
+		// old offsets. A run inside one paragraph that neither adds nor takes away a break wraps it again in place,
+		// incrementally for a single change. Any other run replaces its paragraphs with the ones its breaks now make,
+		// as InsertText and EraseText do for one edit. edited(para, removed, added) hears of each run as paragraphs
+		// para to para + removed becoming para to para + added.
+		template <class Edited>
+		void ChangeText(const Text::PieceTable& text, size_t pageStart, const std::vector<Text::Change>& changes, Edited edited)
+		{
+			// How far the changes before each one move the text
+			std::vector<long long> shift(changes.size() + 1, 0);
+			for (size_t i = 0; i < changes.size(); i++)
+				shift[i + 1] = shift[i] + (long long)changes[i].inserted - (long long)changes[i].length;
+
+			std::vector<Text::PieceTable::Piece> pieces;
+			for (size_t end = changes.size(); end > 0;)
+			{
+				const Text::Change& lastChange = changes[end - 1];
+				int first = ParagraphAt((int)(lastChange.offset - pageStart));
+				int last = ParagraphAt((int)(lastChange.offset + lastChange.length - pageStart));
+				size_t begin = end - 1;
+				while (begin > 0 && ParagraphAt((int)(changes[begin - 1].offset + changes[begin - 1].length - pageStart)) >= first)
+					first = ParagraphAt((int)(changes[--begin].offset - pageStart));
+
+				// Breaks can only come in with inserted text
+				bool split = false;
+				for (size_t i = begin; i < end && !split; i++)
+					split = changes[i].inserted && !Breaks(text, (size_t)((long long)changes[i].offset + shift[i]), changes[i].inserted, pieces).empty();
+
+				int start = ParagraphStart(first);
+				size_t paragraphStart = (size_t)((long long)(pageStart + start) + shift[begin]);
+				if (first == last && !split)
+				{
+					if (end - begin == 1)
+						ResizeParagraph(text, paragraphStart, first, (int)(lastChange.offset - pageStart) - start, (int)lastChange.length, (int)lastChange.inserted);
+					else
+					{
+						Paragraph* p = paragraphs[first];
+						int oldLines = p->Size(), delta = (int)(shift[end] - shift[begin]);
+						p->length += delta;
+						p->Reflow(text, paragraphStart);
+
+						if (!indexStale)
+						{
+							lineIndex.add(first, p->Size() - oldLines);
+							charIndex.add(first, delta);
+						}
+					}
+					edited(first, 0, 0);
+				}
+				else
+				{
+					int added = SpliceParagraphs(text, pageStart, changes, shift, begin, end, first, last, pieces);
+					edited(first, last - first, added);
+				}
+				end = begin;
+			}
+		}
+
+		// Positions of the breaks in n characters of the text from offset
+		static std::vector<size_t> Breaks(const Text::PieceTable& text, size_t offset, size_t n, std::vector<Text::PieceTable::Piece>& pieces)
+		{
+			std::vector<size_t> found;
+			pieces.clear();
+			text.slice(offset, n, pieces);
+			for (const Text::PieceTable::Piece& piece : pieces)
+			{
+				const char* data = text.pieceData(piece);
+				for (const char* at = data; (at = (const char*)memchr(at, PARAGRAPH, piece.length - (at - data))) != nullptr; at++)
+					found.push_back(offset + (at - data));
+				offset += piece.length;
+			}
+			return found;
+		}
+
+		// Replace paragraphs first to last, which changes begin to end reach into, with the ones the breaks in their
+		// text now make. The first keeps its rows up to the first change, every other one is wrapped whole. Each takes
+		// the alignment of the paragraph its start was in, or for a start inside inserted text the paragraph the text
+		// went into. Returns how many paragraphs were added after first.
+		int SpliceParagraphs(const Text::PieceTable& text, size_t pageStart, const std::vector<Text::Change>& changes, const std::vector<long long>& shift,
+			size_t begin, size_t end, int first, int last, std::vector<Text::PieceTable::Piece>& pieces)
+		{
+			int start = ParagraphStart(first), oldEnd = ParagraphStart(last) + paragraphs[last]->length;
+			size_t paragraphStart = (size_t)((long long)(pageStart + start) + shift[begin]);
+			size_t paragraphEnd = (size_t)((long long)(pageStart + oldEnd) + shift[end]);
+
+			// Text before the first change and after the last one holds no breaks
+			size_t from = (size_t)((long long)changes[begin].offset + shift[begin]);
+			size_t to = (size_t)((long long)changes[end - 1].offset + shift[end - 1]) + changes[end - 1].inserted;
+			std::vector<size_t> breaks = Breaks(text, from, to - from, pieces);
+
+			// Where in the old text each new paragraph starts, for its alignment
+			auto alignmentAt = [&](size_t at)
+			{
+				size_t old = (size_t)((long long)at - shift[end]);
+				for (size_t i = begin; i < end; i++)
+				{
+					size_t changeAt = (size_t)((long long)changes[i].offset + shift[i]);
+					if (at < changeAt) { old = (size_t)((long long)at - shift[i]); break; }
+					if (at < changeAt + changes[i].inserted) { old = changes[i].offset; break; }
+				}
+				return paragraphs[ParagraphAt((int)(old - pageStart))]->alignment;
+			};
+
+			std::vector<Paragraph*> added;
+			std::vector<eTextAlignment> alignments;
+			for (size_t b : breaks) alignments.push_back(alignmentAt(b + 1));
+
+			Paragraph* p = paragraphs[first];
+			int oldLines = p->Size(), oldLength = p->length;
+			p->length = (int)((breaks.empty() ? paragraphEnd : breaks[0]) - paragraphStart);
+			p->ReflowFrom(text, paragraphStart, (int)(changes[begin].offset - pageStart) - start);
+
+			for (size_t i = 0; i < breaks.size(); i++)
+			{
+				Paragraph* next = new Paragraph();
+				next->alignment = alignments[i];
+				next->length = (int)((i + 1 < breaks.size() ? breaks[i + 1] : paragraphEnd) - breaks[i] - 1);
+				next->Reflow(text, breaks[i] + 1);
+				added.push_back(next);
+			}
+
+			for (int i = first + 1; i <= last; i++) delete paragraphs[i];
+			paragraphs.erase(paragraphs.begin() + first + 1, paragraphs.begin() + last + 1);
+			paragraphs.insert(paragraphs.begin() + first + 1, added.begin(), added.end());
+
+			if (!indexStale)
+			{
+				lineIndex.add(first, p->Size() - oldLines);
+				charIndex.add(first, p->length - oldLength);
+			}
+			IndexErased(first + 1, last - first);
+			IndexInserted(first + 1, (int)added.size());
+			return (int)added.size();
+		}
+
+		// Alignment moves rows but never changes where they break
+		void SetAlignment(const Text::PieceTable& text, size_t pageStart, int para, eTextAlignment alignment)
+		{
+			paragraphs[para]->alignment = alignment;
+			paragraphs[para]->Reflow(text, pageStart + ParagraphStart(para));
+		}
+	};
+
+	struct Document {
+
+		struct CaretPos {
+			Document* doc;
+			int PAGE = 0, LINE = 0, CHAR = 0;
+
+			CaretPos(Document* document) : doc(document) {}
+
+			void DrawCaret(TextEditor* editor, int scrollLine)
+			{
+				Line* line = GetLine();
+				std::string chars = line->stretch > 0.0f ? line->Shown(doc->text, doc->LineStart(PAGE, LINE)) : std::string();
+				float x = line->CharX(chars.data(), CHAR);
+				int row = LINE - scrollLine;
+
+				// Past the end of a full row the caret shows at the start of the next
+				if (x >= LINE_WIDTH * 8) { x = 0.0f; row++; }
+				editor->FillRect({ (int)x, row * 8 }, {8, 8});
+			}
+
+			// Where the caret is in the text, and placing it there on its page
+			size_t Offset()
+			{
+				size_t lineStart = doc->LineStart(PAGE, LINE);
+				return lineStart + GetLine()->ByteOf(doc->text, lineStart, CHAR);
+			}
+
+			void SetOffset(size_t offset)
+			{
+				size_t pageStart = doc->PageStart(PAGE);
+				CharPos pos = GetPage()->OffsetToPos(doc->text, pageStart, (int)(offset - pageStart));
+				LINE = pos.LINE;
+				CHAR = pos.CHAR;
+			}
+
+			Page* GetPage() { return doc->pages[PAGE]; }
+			Paragraph* GetParagraph() { return GetPage()->GetParagraphPtr(LINE); }
+			Line* GetLine() { return GetPage()->GetLinePtr(LINE); }
+
+			// Navigate pages
+			bool PageUp() { if (PAGE > 0) { PAGE--; return true; } else return false; }
+			bool TryPageUp() { if (PAGE > 0) return true; else return false; }
+			bool PageDown() { if (doc->pages.size() - 1 > PAGE) { PAGE++; return true; } else return false; }
+			bool PageWrapUp() { if (PageUp()) { LINE = GetPage()->GetLineNum() - 1; return true; } else return false; }
+			bool TryPageWrapUp() { if (TryPageUp()) { return true; } else return false; }
+			bool PageWrapDown() { if (PageDown()) { LINE = 0; return true; } else return false; }
+
+			// Navigate lines
+			bool LineUp() { if (LINE > 0) { LINE--; return true; } else return PageWrapUp(); }
+			bool TryLineUp() { if (LINE > 0) { return true; } else return TryPageWrapUp(); }
+			bool LineDown() { if (GetPage()->GetLineNum() - 1 > LINE) { LINE++; return true; } else return PageWrapDown(); }
+			bool LineWrapUp() { if (LineUp()) { CHAR = GetLine()->Columns(); return true; } else return false; }
+			bool LineWrapDown() { if (LineDown()) { CHAR = 0; return true; } else return false; }
+			bool LineEnd() { CHAR = GetLine()->Columns(); return true; }
+			bool LineHome() { CHAR = 0; return true; }
+
+			// Navigate characters, a column holds one grapheme however many bytes it takes
+			bool CharRight() { if (GetLine()->Columns() > CHAR) { CHAR++; return true; } else return LineWrapDown(); }
+			bool CharLeft() { if (CHAR > 0) { CHAR--; return true; } else return LineWrapUp(); }
+			bool TabRight() { if (GetLine()->Columns() > CHAR + TAB_SIZE) { CHAR += TAB_SIZE; return true; } else return LineWrapDown(); }
+			bool TabLeft() { if (CHAR > TAB_SIZE) { CHAR -= TAB_SIZE; return true; } else return LineWrapUp(); }
+
+			std::string to_string()
+			{
+				return "CHAR: " + std::to_string(CHAR) + " LINE: " + std::to_string(LINE) + " PARAGRAPH: " + std::to_string(GetPage()->GetLinePos(LINE).PARA) + " PAGE: " + std::to_string(PAGE);
+			}
+
+			// TODO: Navigate to next space (ctrl + right/left)
+		};
+
+		Text::PieceTable text;
+		Text::StyleRuns styles;
+		Text::UndoJournal undo;
+		// Journals edits in the background while the document has a file
+		Text::Autosave autosave;
+		// Syntax colours for source files, worked out a screen at a time
+		Text::Highlighter highlighter;
+		std::vector<Page*> pages;
+		CaretPos caretPos = CaretPos(this);
+		// Where the caret's selection starts, when there is one
+		size_t selectionStart = 0;
+		bool textSelected = false;
+		// Further carets on the caret's page, each with the selection it makes, sorted and apart from each other and
+		// from the caret. Edits at all of them go in together.
+		struct Selection {
+			size_t anchor, head;
+
+			size_t Start() const { return std::min(anchor, head); }
+			size_t End() const { return std::max(anchor, head); }
+		};
+		std::vector<Selection> carets;
+		// First line on screen
+		int scrollLine = 0;
+		// Every visible character goes out in this one batch
+		util::GlyphBatch glyphs;
+		bool CAPSLOCK = false, NUMLOCK = false;
+		
+		// Keys pressed this frame, handled in order once they are all gathered
+		struct KeyEvent {
+			olc::Key key;
+			bool shift, ctrl;
+		};
+		std::vector<KeyEvent> keyQueue;
+
+		Document()
+		{
+			pages.push_back(new Page());
+		}
+
+		~Document() { DeletePages(); }
+
+		void DeletePages()
+		{
+			for (Page* p : pages)
+			{
+				for (Paragraph* para : p->paragraphs) delete para;
+				delete p;
+			}
+			pages.clear();
+		}
+
+		// File the text came from, saved back to with ctrl + S
+		std::string filePath;
+
+		// Map the file and use it as the piece table's original text, only the paragraph breaks are read up front
+		bool Open(const std::string& path)
+		{
+			std::shared_ptr<util::TextFile> file = std::make_shared<util::TextFile>();
+			if (!file->open(path))
+				return false;
+
+			text = Text::PieceTable(file->data(), file->size(), file);
+
+			// Bytes that are not UTF-8 still load, each one shows as a '?' of its own
+			size_t valid = Text::validateUtf8(file->data(), file->size());
+			if (valid != file->size()) Log(path + " is not valid UTF-8 from byte " + std::to_string(valid));
+
+			// Unsaved edits from a session that crashed are put back
+			bool recovered = Text::Autosave::recover(path, text);
+			if (recovered) Log("Recovered unsaved changes to " + path);
+
+			styles = Text::StyleRuns();
+			styles.insert(0, text.size());
+			undo.clear();
+			autosave.start(path, text, recovered);
+
+			filePath = path;
+			RebuildParagraphs();
+
+			caretPos = CaretPos(this);
+			ClearSelections();
+			scrollLine = 0;
+			return true;
+		}
+
+		// Replace every page with one whose paragraphs are found from the text, only the breaks are looked at
+		void RebuildParagraphs()
+		{
+			DeletePages();
+
+			Page* page = new Page();
+			int length = 0;
+			size_t paragraphStart = 0;
+
+			for (const Text::PieceTable::Piece& piece : text.getPieces())
+			{
+				const char* data = text.pieceData(piece), *end = data + piece.length;
+				for (const char* start = data; ; )
+				{
+					const char* found = (const char*)memchr(start, PARAGRAPH, end - start);
+					length += (int)((found ? found : end) - start);
+					if (!found) break;
+
+					page->paragraphs.back()->length = length;
+					page->paragraphs.back()->Reflow(text, paragraphStart);
+					page->paragraphs.push_back(new Paragraph());
+					paragraphStart += length + 1;
+					length = 0;
+					start = found + 1;
+				}
+			}
+
+			page->paragraphs.back()->length = length;
+			page->paragraphs.back()->Reflow(text, paragraphStart);
+			page->indexStale = true;
+			pages.push_back(page);
+
+			highlighter.reset(Text::tokenizerFor(filePath), (int)page->paragraphs.size());
+		}
+
+		// Stream the pieces straight to disk, the text is never joined into one buffer
+		bool Save(const std::string& path)
+		{
+			std::vector<std::pair<const char*, size_t>> chunks;
+			for (const Text::PieceTable::Piece& piece : text.getPieces())
+				chunks.push_back({ text.pieceData(piece), piece.length });
+
+			if (!util::TextFile::save(path, chunks)) return false;
+			if (path == filePath) autosave.saved();
+			return true;
+		}
+
+		// Only the lines on screen of the caret's page are drawn, as a single decal
+		void DrawDoc(TextEditor* editor)
+		{
+			// The find bar takes the bottom line
+			int visibleLines = editor->ScreenHeight() / 8 - (finding ? 1 : 0);
+
+			DrawSelections(editor, visibleLines);
+			LayOutFrame(visibleLines);
+			glyphs.draw(editor);
+			caretPos.DrawCaret(editor, scrollLine);
+
+			if (finding)
+			{
+				editor->FillRectDecal({ 0.0f, visibleLines * 8.0f }, { (float)editor->ScreenWidth(), 8.0f }, olc::DARK_BLUE);
+				editor->DrawStringDecal({ 0.0f, visibleLines * 8.0f }, "Find: " + findQuery, olc::WHITE);
+			}
+		}
+
+		// Everything a frame needs short of the window: scroll to the caret, colour the lines coming into view and
+		// put the visible text in the glyph batch
+		void LayOutFrame(int visibleLines)
+		{
+			ScrollToCaret(visibleLines);
+
+			Page* page = caretPos.GetPage();
+			size_t pageStart = PageStart(caretPos.PAGE);
+			if (highlighter.active())
+			{
+				int lastLine = std::max(0, std::min(scrollLine + visibleLines, page->GetLineNum()) - 1);
+				highlighter.update(text, styles, page->GetLinePos(scrollLine).PARA, page->GetLinePos(lastLine).PARA,
+					[&](int para, size_t& offset, size_t& length) { offset = pageStart + page->ParagraphStart(para); length = page->paragraphs[para]->length; });
+			}
+
+			page->DrawLines(glyphs, text, styles, pageStart, scrollLine, visibleLines);
+		}
+
+		// Shade selected text and draw the other carets, only those on screen are looked at. The text is drawn over
+		// the shading.
+		void DrawSelections(TextEditor* editor, int visibleLines)
+		{
+			if (!Selecting()) return;
+
+			Page* page = caretPos.GetPage();
+			int lastLine = std::min(scrollLine + visibleLines, page->GetLineNum()) - 1;
+			if (lastLine < scrollLine) return;
+			size_t first = LineStart(caretPos.PAGE, scrollLine), last = LineStart(caretPos.PAGE, lastLine) + page->GetLinePtr(lastLine)->length;
+
+			auto shade = [&](const Selection& s)
+			{
+				if (s.anchor == s.head || s.End() < first || s.Start() > last) return;
+
+				CaretPos from = caretPos, to = caretPos;
+				from.SetOffset(std::max(s.Start(), first));
+				to.SetOffset(std::min(s.End(), last));
+				for (int line = from.LINE; line <= to.LINE; line++)
+				{
+					Line* row = page->GetLinePtr(line);
+					std::string chars = row->stretch > 0.0f ? row->Shown(text, LineStart(caretPos.PAGE, line)) : std::string();
+					float x0 = row->CharX(chars.data(), line == from.LINE ? from.CHAR : 0);
+					float x1 = row->CharX(chars.data(), line == to.LINE ? to.CHAR : row->Columns());
+					editor->FillRect({ (int)x0, (line - scrollLine) * 8 }, { std::max(1, (int)(x1 - x0)), 8 }, olc::Pixel(38, 79, 120));
+				}
+			};
+
+			if (textSelected) shade({ selectionStart, CaretOffset() });
+
+			auto it = std::lower_bound(carets.begin(), carets.end(), first, [](const Selection& s, size_t offset) { return s.End() < offset; });
+			for (; it != carets.end() && it->Start() <= last; ++it)
+			{
+				shade(*it);
+				CaretPos caret = caretPos;
+				caret.SetOffset(it->head);
+				caret.DrawCaret(editor, scrollLine);
+			}
+		}
+
+		// Ctrl + F opens the find bar, typing goes into the query and return jumps to the next match
+		bool finding = false;
+		std::string findQuery;
+
+		// Put the caret after the next match past it, wrapping round to the top
+		bool FindNext(const std::string& needle)
+		{
+			Text::Searcher searcher(text);
+			size_t found = searcher.find(needle, CaretOffset());
+			if (found == Text::Searcher::npos) found = searcher.find(needle, 0);
+			if (found == Text::Searcher::npos) return false;
+
+			ClearSelections();
+			SetCaret(found + needle.size());
+			undo.breakGroup();
+			return true;
+		}
+
+		// Replace every match as a single edit and undo step, the text between matches keeps its pieces
+		size_t ReplaceAll(const std::string& needle, const std::string& replacement)
+		{
+			std::vector<size_t> matches = Text::Searcher::nonOverlapping(Text::Searcher(text).findAll(needle), needle.size());
+			if (matches.empty()) return 0;
+
+			size_t caret = CaretOffset();
+			std::vector<Text::Change> changes;
+			changes.reserve(matches.size());
+			for (size_t match : matches) changes.push_back({ match, needle.size(), replacement.size() });
+
+			// The replacement is stored once and every match points at it
+			std::vector<Text::PieceTable::Piece> list;
+			if (!replacement.empty()) list.assign(matches.size(), text.append(replacement.data(), replacement.size()));
+
+			ClearSelections();
+			ApplyChanges(changes, list);
+
+			// The caret moves with the text before it, from inside a match to the end of its replacement
+			size_t shifted = std::lower_bound(matches.begin(), matches.end(), caret) - matches.begin();
+			if (shifted > 0 && caret < matches[shifted - 1] + needle.size()) caret = matches[shifted - 1] + needle.size();
+			SetCaret(caret - shifted * needle.size() + shifted * replacement.size());
+			return matches.size();
+		}
+
+		// Apply a batch of changes as one edit, each one's inserted text being the next pieces of list. The piece
+		// table, the styles and the paragraphs each take the whole batch in a single pass, so editing thousands of
+		// places at once costs about as much as one pass over the text. Made one undo step unless it is an undo or
+		// redo itself. The caret is left at the start of its page for the caller to place.
+		void ApplyChanges(const std::vector<Text::Change>& batch, const std::vector<Text::PieceTable::Piece>& list, bool record = true)
+		{
+			std::vector<Text::Change> changes;
+			changes.reserve(batch.size());
+			for (const Text::Change& change : batch)
+				if (change.length || change.inserted) changes.push_back(change);
+			if (changes.empty()) return;
+
+			size_t pageStart = PageStart(caretPos.PAGE);
+			Page* page = caretPos.GetPage();
+
+			// What each change takes out
+			std::vector<Text::PieceTable::Piece> removed;
+			std::vector<size_t> removedFrom;
+			for (const Text::Change& change : changes)
+			{
+				removedFrom.push_back(removed.size());
+				text.slice(change.offset, change.length, removed);
+			}
+			removedFrom.push_back(removed.size());
+
+			text.splice(changes, list.data());
+			styles.splice(changes);
+
+			// The journal and the undo history take the changes one after another, each moved by the ones before
+			if (record) undo.beginBatch();
+			long long shift = 0;
+			const Text::PieceTable::Piece* inserted = list.data();
+			for (size_t i = 0; i < changes.size(); i++)
+			{
+				const Text::Change& change = changes[i];
+				size_t at = (size_t)((long long)change.offset + shift), count = 0;
+				for (size_t n = 0; n < change.inserted; n += inserted[count++].length) {}
+
+				if (change.length)
+				{
+					autosave.erased(at, change.length);
+					if (record) undo.recordErase(at, change.length, std::vector<Text::PieceTable::Piece>(removed.begin() + removedFrom[i], removed.begin() + removedFrom[i + 1]), false);
+				}
+				if (change.inserted)
+				{
+					if (autosave.active())
+					{
+						std::string s = text.substr(at, change.inserted);
+						autosave.inserted(at, s.data(), s.size());
+					}
+					if (record) undo.recordInsert(at, change.inserted, std::vector<Text::PieceTable::Piece>(inserted, inserted + count), false);
+				}
+
+				inserted += count;
+				shift += (long long)change.inserted - (long long)change.length;
+			}
+			if (record) undo.endBatch();
+
+			page->ChangeText(text, pageStart, changes, [&](int para, int removed, int added) { highlighter.edited(para, removed, added); });
+
+			caretPos.LINE = 0;
+			caretPos.CHAR = 0;
+		}
+
+		// Put a step of the undo history back. A step whose records each keep clear of the ones before, such as one
+		// made by a batch, goes back in as a batch, anything else a record at a time.
+		bool ApplyStep(bool back)
+		{
+			std::vector<std::pair<Text::UndoJournal::Record, const Text::PieceTable::Piece*>> step;
+			auto gather = [&](const Text::UndoJournal::Record& r, const Text::PieceTable::Piece* p) { step.push_back({ r, p }); };
+			if (!(back ? undo.undo(gather) : undo.redo(gather))) return false;
+			ClearSelections();
+
+			std::vector<Text::Change> changes;
+			std::vector<Text::PieceTable::Piece> list;
+			size_t caret;
+			if (step.size() > 1 && AsBatch(step, changes, list, caret))
+			{
+				ApplyChanges(changes, list, false);
+				SetCaret(caret);
+			}
+			else
+				for (const auto& r : step) ApplyRecord(r.first, r.second);
+			return true;
+		}
+
+		// Turn the records of a step into a batch, when they go down the text with each one before the last, or up it
+		// with each one after the last one's new text. An erase followed by an insert at the same place is one change.
+		// caret is where the last record leaves the caret.
+		static bool AsBatch(const std::vector<std::pair<Text::UndoJournal::Record, const Text::PieceTable::Piece*>>& step,
+			std::vector<Text::Change>& changes, std::vector<Text::PieceTable::Piece>& list, size_t& caret)
+		{
+			struct Pending {
+				Text::Change change;
+				const Text::PieceTable::Piece* pieces;
+				size_t count;
+			};
+			std::vector<Pending> order;
+			for (const auto& r : step)
+			{
+				const Text::UndoJournal::Record& record = r.first;
+				if (record.insert && !order.empty() && order.back().change.offset == record.offset && order.back().change.length && !order.back().change.inserted)
+				{
+					order.back().change.inserted = record.length;
+					order.back().pieces = r.second;
+					order.back().count = record.pieceCount;
+				}
+				else if (record.insert)
+					order.push_back({ { record.offset, 0, record.length }, r.second, record.pieceCount });
+				else
+					order.push_back({ { record.offset, record.length, 0 }, nullptr, 0 });
+			}
+
+			auto clear = [&](bool down)
+			{
+				for (size_t i = 1; i < order.size(); i++)
+				{
+					const Text::Change& a = order[i - 1].change, &b = order[i].change;
+					if (down ? b.offset + b.length > a.offset : b.offset < a.offset + a.inserted) return false;
+				}
+				return true;
+			};
+			bool down = clear(true);
+			if (!down && !clear(false)) return false;
+
+			// Going down every offset is already into the text before the step, going up each is moved by the changes
+			// before it
+			if (down) std::reverse(order.begin(), order.end());
+			long long shift = 0;
+			for (Pending& pending : order)
+			{
+				if (!down) pending.change.offset = (size_t)((long long)pending.change.offset - shift);
+				changes.push_back(pending.change);
+				list.insert(list.end(), pending.pieces, pending.pieces + pending.count);
+				if (changes.size() == (down ? 1 : order.size()))
+					caret = (size_t)((long long)pending.change.offset + shift) + pending.change.inserted;
+				shift += (long long)pending.change.inserted - (long long)pending.change.length;
+			}
+			return true;
+		}
+
+		// Move the view just enough to keep the caret on screen
+		void ScrollToCaret(int visibleLines)
+		{
+			if (caretPos.LINE < scrollLine) scrollLine = caretPos.LINE;
+			if (caretPos.LINE >= scrollLine + visibleLines) scrollLine = caretPos.LINE - visibleLines + 1;
+		}
+
+		// Offset of the page's first character in the text
+		size_t PageStart(int page)
+		{
+			size_t offset = 0;
+			for (int i = 0; i < page; i++)
+				offset += pages[i]->Length() + 1;
+			return offset;
+		}
+
+		// Offset of the start of a row of a page
+		size_t LineStart(int page, int line)
+		{
+			CharPos pos = pages[page]->GetLinePos(line);
+			return PageStart(page) + pages[page]->ParagraphStart(pos.PARA) + pages[page]->paragraphs[pos.PARA]->lines[pos.LINE].start;
+		}
+
+		size_t CaretLineStart() { return LineStart(caretPos.PAGE, caretPos.LINE); }
+		size_t CaretOffset() { return caretPos.Offset(); }
+
+		// Place the caret on the current page by text offset
+		void SetCaret(size_t offset) { caretPos.SetOffset(offset); }
+
+		bool Selecting() const { return textSelected || !carets.empty(); }
+
+		// Back to the caret alone, selecting nothing
+		void ClearSelections()
+		{
+			carets.clear();
+			textSelected = false;
+		}
+
+		// The caret's selection among all the others, in order, and which one it is
+		std::vector<Selection> Selections(size_t& primary)
+		{
+			size_t head = CaretOffset();
+			Selection caret{ textSelected ? selectionStart : head, head };
+
+			std::vector<Selection> all = carets;
+			primary = std::lower_bound(all.begin(), all.end(), caret.Start(), [](const Selection& s, size_t offset) { return s.Start() < offset; }) - all.begin();
+			all.insert(all.begin() + primary, caret);
+			return all;
+		}
+
+		// Make these the carets and their selections, the one at primary being the caret. Any that overlap, or meet
+		// where one of them is empty, become one.
+		void SetSelections(const std::vector<Selection>& all, size_t primary)
+		{
+			std::vector<size_t> order(all.size());
+			for (size_t i = 0; i < order.size(); i++) order[i] = i;
+			std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return all[a].Start() < all[b].Start(); });
+
+			std::vector<Selection> merged;
+			size_t caret = 0;
+			for (size_t i : order)
+			{
+				const Selection& s = all[i];
+				Selection* last = merged.empty() ? nullptr : &merged.back();
+				if (last && (s.Start() < last->End() || (s.Start() == last->End() && (s.anchor == s.head || last->anchor == last->head))))
+				{
+					// The first keeps its direction and takes in the other
+					size_t end = std::max(last->End(), s.End());
+					if (last->head >= last->anchor) last->head = end;
+					else last->anchor = end;
+				}
+				else
+					merged.push_back(s);
+				if (i == primary) caret = merged.size() - 1;
+			}
+
+			Selection chosen = merged[caret];
+			merged.erase(merged.begin() + caret);
+			carets.swap(merged);
+
+			// A caret at the end of a full row keeps showing there
+			if (CaretOffset() != chosen.head) SetCaret(chosen.head);
+			selectionStart = chosen.anchor;
+			textSelected = chosen.anchor != chosen.head;
+		}
+
+		// A caret after each change's new text, the one for the change at primary being the caret
+		void PlaceCarets(const std::vector<Text::Change>& changes, size_t primary)
+		{
+			std::vector<Selection> all;
+			all.reserve(changes.size());
+			long long shift = 0;
+			for (const Text::Change& change : changes)
+			{
+				size_t end = (size_t)((long long)change.offset + shift) + change.inserted;
+				all.push_back({ end, end });
+				shift += (long long)change.inserted - (long long)change.length;
+			}
+			SetSelections(all, primary);
+		}
+
+		// Start of the grapheme before offset, which is past the start of the page
+		size_t GraphemeBefore(size_t offset, size_t pageStart)
+		{
+			size_t from = offset - std::min<size_t>(offset - pageStart, WRAP_WINDOW);
+			std::string before = text.substr(from, offset - from);
+			return from + Text::previousGrapheme(before.data(), before.size());
+		}
+
+		// Type s over every selection, or at every caret, as one edit and one undo step
+		void ReplaceSelections(const std::string& s)
+		{
+			size_t primary;
+			std::vector<Selection> all = Selections(primary);
+
+			std::vector<Text::Change> changes;
+			changes.reserve(all.size());
+			for (const Selection& selection : all) changes.push_back({ selection.Start(), selection.End() - selection.Start(), s.size() });
+
+			std::vector<Text::PieceTable::Piece> list;
+			if (!s.empty()) list.assign(changes.size(), text.append(s.data(), s.size()));
+
+			ApplyChanges(changes, list);
+			PlaceCarets(changes, primary);
+		}
+
+		// Backspace at every caret: a selection goes, an empty one takes the grapheme before it with it
+		void DeleteSelections()
+		{
+			size_t primary, pageStart = PageStart(caretPos.PAGE);
+			std::vector<Selection> all = Selections(primary);
+
+			// Graphemes before carets can run into the selection before them, the two go as one
+			std::vector<Text::Change> changes;
+			size_t caret = 0;
+			for (size_t i = 0; i < all.size(); i++)
+			{
+				size_t start = all[i].Start(), end = all[i].End();
+				if (start == end && start > pageStart) start = GraphemeBefore(start, pageStart);
+
+				if (!changes.empty() && start <= changes.back().offset + changes.back().length)
+					changes.back().length = std::max(changes.back().length, end - changes.back().offset);
+				else
+					changes.push_back({ start, end - start, 0 });
+				if (i == primary) caret = changes.size() - 1;
+			}
+
+			ApplyChanges(changes, {});
+			PlaceCarets(changes, caret);
+		}
+
+		// Ctrl + D: select the word at the caret, then with each press add a caret selecting the next place the
+		// same text is found after the last caret, wrapping round to the top
+		void SelectNextMatch()
+		{
+			size_t primary;
+			std::vector<Selection> all = Selections(primary);
+			Selection& caret = all[primary];
+
+			if (caret.anchor == caret.head)
+			{
+				size_t pageStart = PageStart(caretPos.PAGE), pageEnd = pageStart + caretPos.GetPage()->Length();
+				auto isWord = [this](size_t offset) { char c = text.at(offset); return isalnum((unsigned char)c) || c == '_' || (uint8_t)c >= 0x80; };
+
+				size_t start = caret.head, end = caret.head;
+				while (start > pageStart && isWord(start - 1)) start--;
+				while (end < pageEnd && isWord(end)) end++;
+				if (start == end) return;
+
+				caret = { start, end };
+				SetSelections(all, primary);
+				return;
+			}
+
+			std::string needle = text.substr(caret.Start(), caret.End() - caret.Start());
+			Text::Searcher searcher(text);
+			size_t found = searcher.find(needle, all.back().End());
+			if (found == Text::Searcher::npos) found = searcher.find(needle, 0);
+			if (found == Text::Searcher::npos) return;
+
+			// Every match already has a caret
+			for (const Selection& selection : all)
+				if (selection.Start() == found) return;
+
+			all.push_back({ found, found + needle.size() });
+			SetSelections(all, primary);
+		}
+
+		// Ctrl + shift + D: a caret selecting every match of the selection, or of the word at the caret, so they can
+		// all be retyped at once
+		void SelectAllMatches()
+		{
+			if (!textSelected) SelectNextMatch();
+			if (!textSelected) return;
+
+			size_t head = CaretOffset(), start = std::min(selectionStart, head);
+			std::string needle = text.substr(start, std::max(selectionStart, head) - start);
+			std::vector<size_t> matches = Text::Searcher::nonOverlapping(Text::Searcher(text).findAll(needle), needle.size());
+
+			std::vector<Selection> all;
+			all.reserve(matches.size());
+			size_t primary = 0;
+			for (size_t match : matches)
+			{
+				if (match == start) primary = all.size();
+				all.push_back({ match, match + needle.size() });
+			}
+			SetSelections(all, primary);
+		}
+
+		// Every edit goes through InsertText and EraseText so the undo journal sees it, coalesce lets it join the
+		// previous undo step when it carries straight on from it
+		void InsertText(size_t offset, const char* s, size_t n, bool coalesce = false)
+		{
+			if (n == 0) return;
+
+			undo.recordInsert(offset, n, text.addedSize(), coalesce);
+			text.insert(offset, s, n);
+			TextInserted(offset, n);
+		}
+
+		void EraseText(size_t offset, size_t n, bool coalesce = false)
+		{
+			if (n == 0) return;
+
+			std::vector<Text::PieceTable::Piece> removed;
+			text.slice(offset, n, removed);
+			undo.recordErase(offset, n, removed, coalesce);
+			RemoveText(offset, n);
+		}
+
+		// Styles and paragraphs for text already in the piece table
+		void TextInserted(size_t offset, size_t n)
+		{
+			std::string inserted = text.substr(offset, n);
+			styles.insert(offset, n);
+			autosave.inserted(offset, inserted.data(), n);
+
+			size_t pageStart = PageStart(caretPos.PAGE);
+			Page* page = caretPos.GetPage();
+			highlighter.edited(page->ParagraphAt((int)(offset - pageStart)), 0, (int)std::count(inserted.begin(), inserted.end(), PARAGRAPH));
+			page->InsertText(text, pageStart, (int)(offset - pageStart), inserted);
+		}
+
+		void RemoveText(size_t offset, size_t n)
+		{
+			size_t pageStart = PageStart(caretPos.PAGE);
+			Page* page = caretPos.GetPage();
+			int first = page->ParagraphAt((int)(offset - pageStart)), last = page->ParagraphAt((int)(offset + n - pageStart));
+			highlighter.edited(first, last - first, 0);
+
+			text.erase(offset, n);
+			styles.erase(offset, n);
+			autosave.erased(offset, n);
+			page->EraseText(text, pageStart, (int)(offset - pageStart), (int)n);
+		}
+
+		// Apply a journal record, the pieces put back exactly the text that was there
+		void ApplyRecord(const Text::UndoJournal::Record& record, const Text::PieceTable::Piece* pieces)
+		{
+			if (record.insert)
+			{
+				text.insertPieces(record.offset, pieces, record.pieceCount);
+				TextInserted(record.offset, record.length);
+				SetCaret(record.offset + record.length);
+			}
+			else
+			{
+				RemoveText(record.offset, record.length);
+				SetCaret(record.offset);
+			}
+		}
+
+		bool Undo() { return ApplyStep(true); }
+		bool Redo() { return ApplyStep(false); }
+
+		void SetAlignment(eTextAlignment alignment)
+		{
+			Page* page = caretPos.GetPage();
+			page->SetAlignment(text, PageStart(caretPos.PAGE), page->GetLinePos(caretPos.LINE).PARA, alignment);
+		}
+
+		void AddCharacter(char d)
+		{
+			if (finding)
+			{
+				if (d == PARAGRAPH) FindNext(findQuery);
+				else findQuery += d;
+				return;
+			}
+
+			if (d == '\t')
+			{
+				//caretPos.TabRight();
+				return;
+			}
+
+			if (Selecting())
+			{
+				ReplaceSelections(std::string(1, d));
+				return;
+			}
+
+			// A run of typing is one undo step, a new paragraph starts the next
+			size_t offset = CaretOffset();
+			InsertText(offset, &d, 1, d != PARAGRAPH);
+			SetCaret(offset + 1);
+		}
+
+		// Backspace
+		void DeleteCharacter()
+		{
+			if (finding)
+			{
+				if (!findQuery.empty()) findQuery.pop_back();
+				return;
+			}
+
+			if (Selecting())
+			{
+				DeleteSelections();
+				return;
+			}
+
+			size_t offset = CaretOffset(), pageStart = PageStart(caretPos.PAGE);
+
+			// Return if there is nothing to delete on this page
+			if (offset == pageStart)
+				return;
+
+			// The whole grapheme before the caret goes, found from the bytes just before it
+			size_t start = GraphemeBefore(offset, pageStart);
+
+			EraseText(start, offset - start, true);
+			SetCaret(start);
+		}
+
+		// Arrow keys, home and end move a caret a grapheme or a row at a time
+		static bool Move(CaretPos& caret, olc::Key key)
+		{
+			switch (key)
+			{
+			case olc::LEFT: caret.CharLeft(); break;
+			case olc::RIGHT: caret.CharRight(); break;
+			case olc::UP: caret.LineUp(); break;
+			case olc::DOWN: caret.LineDown(); break;
+			case olc::HOME: caret.LineHome(); break;
+			case olc::END: caret.LineEnd(); break;
+			default: return false;
+			}
+
+			// Rows differ in width, the caret stays on the row it moved to
+			caret.CHAR = std::min(caret.CHAR, caret.GetLine()->Columns());
+			return true;
+		}
+
+		// Every caret moves, with shift held each takes its selection along
+		bool MoveCaret(const KeyEvent& event)
+		{
+			// The caret on its own just moves
+			if (!Selecting() && !event.shift)
+			{
+				if (!Move(caretPos, event.key)) return false;
+				undo.breakGroup();
+				return true;
+			}
+
+			CaretPos probe = caretPos;
+			if (!Move(probe, event.key)) return false;
+
+			size_t primary;
+			std::vector<Selection> all = Selections(primary);
+			for (size_t i = 0; i < all.size(); i++)
+			{
+				Selection& s = all[i];
+				// Left or right without shift only drops a selection, at the end it points to
+				if (!event.shift && s.anchor != s.head && (event.key == olc::LEFT || event.key == olc::RIGHT))
+					s.head = event.key == olc::LEFT ? s.Start() : s.End();
+				else if (i == primary)
+				{
+					Move(caretPos, event.key);
+					s.head = CaretOffset();
+				}
+				else
+				{
+					CaretPos caret = caretPos;
+					caret.SetOffset(s.head);
+					Move(caret, event.key);
+					s.head = caret.Offset();
+				}
+				if (!event.shift) s.anchor = s.head;
+			}
+
+			SetSelections(all, primary);
+			undo.breakGroup();
+			return true;
+		}
+
+		// Queue every key pressed this frame, one pass over the key states, then handle the queue so a frame with
+		// several new keys loses none of them
+		void PollKeyboard(TextEditor* editor)
+		{
+			bool SHIFT = editor->GetKey(olc::SHIFT).bHeld;
+			bool CTRL = editor->GetKey(olc::CTRL).bHeld;
+
+			for (int key = olc::NONE + 1; key < olc::ENUM_END; key++)
+				if (editor->GetKey((olc::Key)key).bPressed)
+					keyQueue.push_back({ (olc::Key)key, SHIFT, CTRL });
+
+			for (const KeyEvent& event : keyQueue)
+				HandleKey(event);
+			keyQueue.clear();
+		}
+
+		void HandleKey(const KeyEvent& event)
+		{
+			if (event.key == olc::CAPS_LOCK) CAPSLOCK = !CAPSLOCK;
+			if (event.key == olc::NUM_LOCK) NUMLOCK = !NUMLOCK;
+
+			if (event.ctrl)
+			{
+				switch (event.key)
+				{
+				case olc::S:
+					if (!filePath.empty())
+						Log(Save(filePath) ? "Saved " + filePath : "Could not save " + filePath);
+					break;
+				// Ctrl + Z undoes, ctrl + Y or ctrl + shift + Z redoes
+				case olc::Z: event.shift ? Redo() : Undo(); break;
+				case olc::Y: Redo(); break;
+				case olc::F: finding = !finding; break;
+				// Ctrl + D adds a caret at the next match of the selection, ctrl + shift + D one at every match
+				case olc::D: event.shift ? SelectAllMatches() : SelectNextMatch(); break;
+				// Ctrl + L, E, R and J align the caret's paragraph left, centred, right or justified
+				case olc::L: SetAlignment(LEFT); break;
+				case olc::E: SetAlignment(CENTER); break;
+				case olc::R: SetAlignment(RIGHT); break;
+				case olc::J: SetAlignment(JUSTIFIED); break;
+				default: break;
+				}
+				return;
+			}
+
+			if (event.key == olc::ESCAPE && finding)
+				finding = false;
+			else if (event.key == olc::ESCAPE)
+				ClearSelections();
+			else if (event.key == olc::BACK)
+				DeleteCharacter();
+			else if (!MoveCaret(event))
+			{
+				// Caps lock only shifts letters
+				bool shifted = event.shift ^ (CAPSLOCK && event.key >= olc::A && event.key <= olc::Z);
+				char c = shifted ? KeyChars.shifted[event.key] : KeyChars.plain[event.key];
+				if (c) AddCharacter(c);
+			}
+		}
+	};
+
+public:
+	Document doc;
+
+	bool OnUserCreate() override
+	{
+		return true;
+	}
+
+	bool OnUserUpdate(float fElapsedTime) override
+	{
+		Clear(olc::BLACK);
+		doc.autosave.update();
+		doc.PollKeyboard(this);
+		doc.DrawDoc(this);
+		return true;
+	}
+};
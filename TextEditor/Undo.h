@@ -0,0 +1,181 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "PieceTable.h"
+
+namespace Text {
+
+	// Undo history as compact records in two append-only arrays. A record is an offset, a length and a range of
+	// piece references: the piece table never writes over its buffers, so the pieces an edit added or removed
+	// still describe that text later and nothing is copied. Records are gathered into groups, one undo step each,
+	// and the oldest groups are dropped once the history passes its limits.
+	class UndoJournal {
+	public:
+		struct Record {
+			size_t offset, length;
+			uint32_t firstPiece, pieceCount;
+			bool insert;
+		};
+
+		// Limits on kept history, the oldest half is dropped when either is passed
+		size_t maxGroups = 10000, maxRecords = 1 << 20;
+
+		void clear()
+		{
+			pieces.clear();
+			records.clear();
+			groups.clear();
+			current = 0;
+			open = false;
+		}
+
+		// The next edit starts a new undo step even if it could have joined the last one
+		void breakGroup() { open = false; }
+
+		// Every record between these is one undo step, whatever it is
+		void beginBatch()
+		{
+			batching = true;
+			batchStarted = false;
+		}
+
+		void endBatch()
+		{
+			batching = false;
+			open = false;
+		}
+
+		bool canUndo() const { return current > 0; }
+		bool canRedo() const { return current < groups.size(); }
+
+		// Typing straight on from the last insert grows that record instead of adding one
+		void recordInsert(size_t offset, size_t length, size_t addedStart, bool coalesce)
+		{
+			if (coalesce && open && !batching && !records.empty())
+			{
+				Record& last = records.back();
+				PieceTable::Piece& piece = pieces.back();
+				if (last.insert && last.pieceCount == 1 && last.offset + last.length == offset &&
+					piece.source == PieceTable::Source::ADD && piece.start + piece.length == addedStart)
+				{
+					last.length += length;
+					piece.length += length;
+					return;
+				}
+			}
+
+			PieceTable::Piece piece{ PieceTable::Source::ADD, addedStart, length };
+			push({ offset, length, 0, 0, true }, &piece, 1, coalesce);
+		}
+
+		void recordInsert(size_t offset, size_t length, const std::vector<PieceTable::Piece>& inserted, bool coalesce)
+		{
+			push({ offset, length, 0, 0, true }, inserted.data(), inserted.size(), coalesce);
+		}
+
+		void recordErase(size_t offset, size_t length, const std::vector<PieceTable::Piece>& removed, bool coalesce)
+		{
+			push({ offset, length, 0, 0, false }, removed.data(), removed.size(), coalesce);
+		}
+
+		// Undo the last step, apply(record, pieces) is called for each record newest first with insert flipped
+		template <class Apply>
+		bool undo(Apply apply)
+		{
+			if (!canUndo()) return false;
+			open = false;
+
+			Group& group = groups[--current];
+			for (size_t r = group.firstRecord + group.recordCount; r-- > group.firstRecord;)
+			{
+				Record inverse = records[r];
+				inverse.insert = !inverse.insert;
+				apply(inverse, &pieces[inverse.firstPiece]);
+			}
+			return true;
+		}
+
+		template <class Apply>
+		bool redo(Apply apply)
+		{
+			if (!canRedo()) return false;
+			open = false;
+
+			Group& group = groups[current++];
+			for (size_t r = group.firstRecord; r < group.firstRecord + group.recordCount; r++)
+				apply(records[r], &pieces[records[r].firstPiece]);
+			return true;
+		}
+
+	private:
+		struct Group {
+			size_t firstRecord, recordCount;
+		};
+
+		std::vector<PieceTable::Piece> pieces;
+		std::vector<Record> records;
+		std::vector<Group> groups;
+		// Groups before this are done, the ones after can be redone
+		size_t current = 0;
+		// Whether the last group still takes coalesced records
+		bool open = false;
+		bool batching = false, batchStarted = false;
+
+		void push(Record record, const PieceTable::Piece* list, size_t count, bool coalesce)
+		{
+			// A new edit ends any redo
+			if (current < groups.size())
+			{
+				Group& first = groups[current];
+				records.resize(first.firstRecord);
+				pieces.resize(records.empty() ? 0 : records.back().firstPiece + records.back().pieceCount);
+				groups.resize(current);
+				open = false;
+			}
+
+			record.firstPiece = (uint32_t)pieces.size();
+			record.pieceCount = (uint32_t)count;
+			pieces.insert(pieces.end(), list, list + count);
+			records.push_back(record);
+
+			if (batching ? batchStarted : coalesce && open && follows(records[records.size() - 2], record))
+				groups.back().recordCount++;
+			else
+			{
+				groups.push_back({ records.size() - 1, 1 });
+				current = groups.size();
+			}
+			batchStarted = batching;
+			open = coalesce && !batching;
+
+			if (groups.size() > 1 && (groups.size() > maxGroups || records.size() > maxRecords))
+				dropOldest(groups.size() / 2);
+		}
+
+		// Typing on from an insert, or deleting back or forward from where the last delete was
+		static bool follows(const Record& last, const Record& next)
+		{
+			if (last.insert != next.insert) return false;
+			return next.insert ? last.offset + last.length == next.offset : next.offset + next.length == last.offset || next.offset == last.offset;
+		}
+
+		// Forget the oldest groups and shift everything after them down
+		void dropOldest(size_t count)
+		{
+			count = std::max<size_t>(1, std::min(count, groups.size() - 1));
+			size_t recordCut = groups[count].firstRecord;
+			size_t pieceCut = records[recordCut].firstPiece;
+
+			records.erase(records.begin(), records.begin() + recordCut);
+			pieces.erase(pieces.begin(), pieces.begin() + pieceCut);
+			groups.erase(groups.begin(), groups.begin() + count);
+
+			for (Record& r : records) r.firstPiece -= (uint32_t)pieceCut;
+			for (Group& g : groups) g.firstRecord -= recordCut;
+			current -= std::min(current, count);
+		}
+	};
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <bitset>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXT_UTF8_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Text {
+
+	// Whether n bytes are all ASCII, sixteen at a time with SSE2
+	inline bool isAscii(const char* s, size_t n)
+	{
+		size_t i = 0;
+#ifdef TEXT_UTF8_SSE2
+		__m128i any = _mm_setzero_si128();
+		for (; i + 16 <= n; i += 16) any = _mm_or_si128(any, _mm_loadu_si128((const __m128i*)(s + i)));
+		if (_mm_movemask_epi8(any)) return false;
+#endif
+		uint8_t high = 0;
+		for (; i < n; i++) high |= (uint8_t)s[i];
+		return high < 0x80;
+	}
+
+	// Decode the code point starting at byte i. Returns its length in bytes, or 0 for a byte that does not start a
+	// well formed sequence (overlong, a surrogate, past U+10FFFF or cut short), which decodes as U+FFFD.
+	inline size_t decodeUtf8(const char* s, size_t n, size_t i, uint32_t& cp)
+	{
+		const uint8_t* u = (const uint8_t*)s + i;
+		if (u[0] < 0x80)
+		{
+			cp = u[0];
+			return 1;
+		}
+
+		size_t length;
+		uint32_t lowest;
+		if ((u[0] & 0xE0) == 0xC0) { length = 2; cp = u[0] & 0x1F; lowest = 0x80; }
+		else if ((u[0] & 0xF0) == 0xE0) { length = 3; cp = u[0] & 0x0F; lowest = 0x800; }
+		else if ((u[0] & 0xF8) == 0xF0) { length = 4; cp = u[0] & 0x07; lowest = 0x10000; }
+		else length = 0;
+
+		bool valid = length != 0 && n - i >= length;
+		for (size_t k = 1; valid && k < length; k++)
+		{
+			valid = (u[k] & 0xC0) == 0x80;
+			cp = (cp << 6) | (u[k] & 0x3F);
+		}
+
+		if (!valid || cp < lowest || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+		{
+			cp = 0xFFFD;
+			return 0;
+		}
+		return length;
+	}
+
+	// Length in bytes of the well formed sequence at byte i, or 0. The two and three byte sequences most scripts use
+	// are checked by their bytes alone, only the rest are decoded.
+	inline size_t sequenceLength(const char* s, size_t n, size_t i)
+	{
+		const uint8_t* u = (const uint8_t*)s;
+		uint8_t c = u[i];
+		if (c < 0x80) return 1;
+		if (c >= 0xC2 && c <= 0xDF && i + 1 < n && (u[i + 1] & 0xC0) == 0x80) return 2;
+		// E0 and ED lead overlongs and surrogates, they take the long way
+		if (c >= 0xE1 && c <= 0xEF && c != 0xED && i + 2 < n && (u[i + 1] & 0xC0) == 0x80 && (u[i + 2] & 0xC0) == 0x80) return 3;
+
+		uint32_t cp;
+		return decodeUtf8(s, n, i, cp);
+	}
+
+	// Length of the part of s that is valid UTF-8, n when all of it is. With SSE2, blocks of sixteen bytes holding
+	// only ASCII and two byte sequences, as most text does, are checked whole: every continuation byte has to come
+	// straight after a lead byte, a lead byte last in a block carrying over to the next. Any other block is checked
+	// a sequence at a time.
+	inline size_t validateUtf8(const char* s, size_t n)
+	{
+		size_t i = 0, length;
+#ifdef TEXT_UTF8_SSE2
+		// Compared as signed bytes: continuations are 0x80 to 0xBF, two byte leads 0xC2 to 0xDF
+		const __m128i contEnd = _mm_set1_epi8((char)0xC0), leadFrom = _mm_set1_epi8((char)0xC1), leadEnd = _mm_set1_epi8((char)0xE0);
+		unsigned carry = 0;
+
+		while (i + 16 <= n)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+			unsigned high = (unsigned)_mm_movemask_epi8(v);
+			if (!high && !carry)
+			{
+				i += 16;
+				continue;
+			}
+
+			unsigned cont = (unsigned)_mm_movemask_epi8(_mm_cmplt_epi8(v, contEnd));
+			unsigned lead = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi8(v, leadFrom), _mm_cmplt_epi8(v, leadEnd)));
+			if ((cont | lead) == high && (((lead << 1) | carry) & 0xFFFF) == cont)
+			{
+				carry = lead >> 15;
+				i += 16;
+				continue;
+			}
+
+			// Back to the lead of a pair the block edge cut, then a sequence at a time to the end of the block
+			size_t end = i + 16;
+			if (carry) i--;
+			carry = 0;
+			while (i < end)
+			{
+				if (!(length = sequenceLength(s, n, i))) return i;
+				i += length;
+			}
+		}
+		if (carry) i--;
+#endif
+		while (i < n)
+		{
+			if (!(length = sequenceLength(s, n, i))) return i;
+			i += length;
+		}
+		return n;
+	}
+
+	// Marks that join the code point before them into one grapheme: combining marks, joiners, variation selectors,
+	// skin tone modifiers and tags. A close enough subset of the Unicode extend property for an 8x8 font.
+	inline bool isGraphemeExtend(uint32_t cp)
+	{
+		static const uint32_t ranges[][2] = {
+			{ 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x05BF, 0x05C7 }, { 0x0610, 0x061A },
+			{ 0x064B, 0x065F }, { 0x0670, 0x0670 }, { 0x06D6, 0x06DC }, { 0x06DF, 0x06E4 }, { 0x0900, 0x0903 },
+			{ 0x093A, 0x094F }, { 0x0951, 0x0957 }, { 0x0962, 0x0963 }, { 0x0E31, 0x0E31 }, { 0x0E34, 0x0E3A },
+			{ 0x0E47, 0x0E4E }, { 0x1AB0, 0x1AFF }, { 0x1DC0, 0x1DFF }, { 0x200C, 0x200D }, { 0x20D0, 0x20FF },
+			{ 0x302A, 0x302F }, { 0x3099, 0x309A }, { 0xFE00, 0xFE0F }, { 0xFE20, 0xFE2F }, { 0x1F3FB, 0x1F3FF },
+			{ 0xE0020, 0xE007F }, { 0xE0100, 0xE01EF }
+		};
+		const size_t count = sizeof(ranges) / sizeof(ranges[0]);
+
+		// Blocks of 64 code points below U+10000 holding any of them, most letters are turned away here
+		static const std::bitset<1024> blocks = []()
+		{
+			std::bitset<1024> b;
+			for (size_t r = 0; r < count; r++)
+				for (uint32_t block = ranges[r][0] >> 6; block <= ranges[r][1] >> 6 && block < 1024; block++)
+					b.set(block);
+			return b;
+		}();
+
+		if (cp < ranges[0][0] || (cp < 0x10000 && !blocks[cp >> 6])) return false;
+		size_t i = std::upper_bound(ranges, ranges + count, cp, [](uint32_t c, const uint32_t* r) { return c < r[0]; }) - ranges;
+		return i > 0 && cp <= ranges[i - 1][1];
+	}
+
+	// Whether the code point b stays in the same grapheme as a, which comes straight before it. Controls stand
+	// alone apart from CR LF, ASCII never extends anything.
+	inline bool joinsGrapheme(uint32_t a, uint32_t b)
+	{
+		if (a == '\r') return b == '\n';
+		if (a < 0x20 || b < 0x80) return false;
+		return a == 0x200D || isGraphemeExtend(b);
+	}
+
+	// End of the grapheme starting at byte i. A byte that is not valid UTF-8 is a grapheme of its own.
+	inline size_t nextGrapheme(const char* s, size_t n, size_t i)
+	{
+		// Plain text takes the quick way
+		if ((uint8_t)s[i] < 0x80 && s[i] != '\r' && (i + 1 == n || (uint8_t)s[i + 1] < 0x80)) return i + 1;
+
+		uint32_t cp, next;
+		size_t j = i + std::max<size_t>(1, decodeUtf8(s, n, i, cp));
+
+		while (j < n)
+		{
+			size_t length = std::max<size_t>(1, decodeUtf8(s, n, j, next));
+			if (!joinsGrapheme(cp, next)) break;
+			cp = next;
+			j += length;
+		}
+		return j;
+	}
+
+	// Start of the code point ending at byte i, stepping over one byte for anything not valid
+	inline size_t previousCodePoint(const char* s, size_t i, uint32_t& cp)
+	{
+		if ((uint8_t)s[i - 1] < 0x80)
+		{
+			cp = (uint8_t)s[i - 1];
+			return i - 1;
+		}
+
+		for (size_t back = 2; back <= 4 && back <= i; back++)
+			if (decodeUtf8(s, i, i - back, cp) == back)
+				return i - back;
+
+		decodeUtf8(s, i, i - 1, cp);
+		return i - 1;
+	}
+
+	// Start of the grapheme ending at byte i, s must hold the whole grapheme before i
+	inline size_t previousGrapheme(const char* s, size_t i)
+	{
+		uint32_t cp, before;
+		size_t j = previousCodePoint(s, i, cp);
+
+		while (j > 0)
+		{
+			size_t k = previousCodePoint(s, j, before);
+			if (!joinsGrapheme(before, cp)) break;
+			cp = before;
+			j = k;
+		}
+		return j;
+	}
+
+	// Byte offsets where each of up to count graphemes starts in s, and where the last one ends: bound needs
+	// count + 1 entries. Returns how many graphemes were found.
+	inline int graphemeBounds(const char* s, size_t n, int count, int* bound)
+	{
+		int found = 0;
+		size_t i = 0;
+		bound[0] = 0;
+		while (i < n && found < count)
+		{
+			i = nextGrapheme(s, n, i);
+			bound[++found] = (int)i;
+		}
+		return found;
+	}
+}
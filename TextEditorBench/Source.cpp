@@ -0,0 +1,430 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <iterator>
+
+#define OLC_PGE_APPLICATION
+#include "../TextEditor/TextEditor.h"
+
+#if defined(_WIN32)
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+/*
+EDITING BENCHMARK
+Drives the TextEditor's Document through scripted workloads without ever opening a window, so changes to the
+text storage, the layout or the work done per frame can be compared by numbers instead of by feel. Each
+operation of a workload is timed on its own, and every workload reports operations per second, latency
+percentiles and the peak resident memory of the process once it is done. The peak only ever grows, run one
+workload at a time to compare memory.
+
+Usage:
+	TextEditorBench [-workload NAME|all] [-scale S] [-seed N] [-dir PATH]
+
+Workloads:
+	typing      characters typed one at a time at the caret, a new paragraph every line or so
+	random      short inserts and deletes at random places in a 20k line document
+	paste       megabyte pastes at random places
+	backspace   backspace held down from the end of a document until it is nearly gone
+	navigate    arrow keys, home, end and jumps across a million lines
+	multicaret  every match of a name selected and retyped at once, then undone
+	replace     every match of a name replaced and put back, after checking where the caret lands
+	frame       what a frame does short of the window: scrolling, highlighting and laying out glyphs
+	openSave    a 20MB file opened, saved to a copy, then edited and saved over itself, written to -dir
+-scale multiplies the work of every workload. Returns non-zero when a workload finds its own result wrong.
+*/
+
+namespace Bench {
+
+	typedef TextEditor::Document Document;
+
+	struct Settings {
+		std::string workload = "all";
+		double scale = 1.0;
+		uint64_t seed = 1;
+		std::string dir = ".";
+	};
+
+	// Largest the process has been in memory so far, in bytes
+	uint64_t peakResident()
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+		return counters.PeakWorkingSetSize;
+#else
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+		return (uint64_t)usage.ru_maxrss;
+#else
+		return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+	}
+
+	// Time taken by each operation of a workload
+	class Timings {
+	public:
+		template <class Operation>
+		void time(Operation operation)
+		{
+			auto start = std::chrono::steady_clock::now();
+			operation();
+			micros.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		void report(const std::string& name)
+		{
+			double total = 0.0;
+			for (double m : micros) total += m;
+			std::sort(micros.begin(), micros.end());
+			auto percentile = [&](double p) { return micros.empty() ? 0.0 : micros[std::min(micros.size() - 1, (size_t)(p * micros.size()))]; };
+
+			std::cout << std::fixed << std::setprecision(1);
+			std::cout << std::left << std::setw(11) << name << std::right << std::setw(9) << micros.size() << " ops  "
+				<< std::setw(8) << std::setprecision(3) << total / 1e6 << " s  " << std::setprecision(0)
+				<< std::setw(10) << (total > 0.0 ? micros.size() / (total / 1e6) : 0.0) << " ops/s  " << std::setprecision(1)
+				<< "p50 " << percentile(0.5) << "  p90 " << percentile(0.9) << "  p99 " << percentile(0.99)
+				<< "  max " << (micros.empty() ? 0.0 : micros.back()) << " us  peak RSS " << peakResident() / (1024.0 * 1024.0) << " MB" << std::endl;
+		}
+
+	private:
+		std::vector<double> micros;
+	};
+
+	// Text like a plain document: words of a few letters, lines of about 60 characters
+	std::string prose(std::mt19937_64& rng, size_t lines)
+	{
+		std::string s;
+		s.reserve(lines * 64);
+		for (size_t l = 0; l < lines; l++)
+		{
+			for (size_t length = 0; length < 60;)
+			{
+				size_t word = 2 + rng() % 8;
+				for (size_t i = 0; i < word; i++) s += (char)('a' + rng() % 26);
+				s += ' ';
+				length += word + 1;
+			}
+			s.back() = '\n';
+		}
+		return s;
+	}
+
+	// Text like a C++ source, for the highlighter
+	std::string source(std::mt19937_64& rng, size_t lines)
+	{
+		static const char* const rows[] = {
+			"\tfor (int i = 0; i < count; i++) total += values[i] * 2;\n",
+			"\t// Adds the weights of every node below this one\n",
+			"\tconst std::string name = \"node\" + std::to_string(index);\n",
+			"#include \"Tree.h\"\n",
+			"\t/* the first pass only counts, the second one\n\t   fills the table it sized */\n",
+			"\tif (node->left != nullptr) return weigh(node->left, 0.5f);\n",
+			"}\n",
+			"static int weigh(Node* node, float factor)\n{\n"
+		};
+		std::string s;
+		for (size_t l = 0; l < lines; l++) s += rows[rng() % (sizeof(rows) / sizeof(rows[0]))];
+		return s;
+	}
+
+	// Put text in a document as if it was opened, without a file
+	void load(Document& doc, std::string s, const std::string& path = "")
+	{
+		doc.text = Text::PieceTable(std::move(s));
+		doc.styles = Text::StyleRuns();
+		doc.styles.insert(0, doc.text.size());
+		doc.undo.clear();
+		doc.filePath = path;
+		doc.RebuildParagraphs();
+		doc.caretPos = Document::CaretPos(&doc);
+		doc.ClearSelections();
+		doc.scrollLine = 0;
+	}
+
+	size_t scaled(const Settings& settings, double count) { return std::max<size_t>(1, (size_t)(count * settings.scale)); }
+
+	bool typing(const Settings& settings, std::mt19937_64& rng, Timings& timings)
+	{
+		TextEditor editor;
+		Document& doc = editor.doc;
+		std::string script = prose(rng, scaled(settings, 200000) / 60);
+
+		for (char c : script)
+			timings.time([&] { doc.AddCharacter(c); });
+		return true;
+	}
+
+	bool randomEdits(const Settings& settings, std::mt19937_64& rng, Timings& timings)
+	{
+		TextEditor editor;
+		Document& doc = editor.doc;
+		load(doc, prose(rng, 20000));
+
+		std::string words = prose(rng, 16);
+		for (size_t i = scaled(settings, 100000); i > 0; i--)
+		{
+			size_t offset = rng() % (doc.text.size() + 1), n = 1 + rng() % 16;
+			if (rng() % 2)
+			{
+				const char* typed = words.data() + rng() % (words.size() - n);
+				timings.time([&] { doc.InsertText(offset, typed, n); doc.SetCaret(offset + n); });
+			}
+			else
+				timings.time([&] { doc.EraseText(offset, std::min(n, doc.text.size() - offset)); doc.SetCaret(offset); });
+		}
+		return true;
+	}
+
+	bool paste(const Settings& settings, std::mt19937_64& rng, Timings& timings)
+	{
+		TextEditor editor;
+		Document& doc = editor.doc;
+		load(doc, prose(rng, 20000));
+
+		std::string clipboard = prose(rng, (1 << 20) / 60);
+		for (size_t i = scaled(settings, 20); i > 0; i--)
+		{
+			size_t offset = rng() % (doc.text.size() + 1);
+			timings.time([&] { doc.InsertText(offset, clipboard.data(), clipboard.size()); doc.SetCaret(offset + clipboard.size()); });
+		}
+		return true;
+	}
+
+	bool backspace(const Settings& settings, std::mt19937_64& rng, Timings& timings)
+	{
+		TextEditor editor;
+		Document& doc = editor.doc;
+		size_t count = scaled(settings, 200000);
+		load(doc, prose(rng, count / 60 + 1));
+		doc.SetCaret(doc.text.size());
+
+		for (size_t i = std::min(count, doc.text.size()); i > 0; i--)
+			timings.time([&] { doc.DeleteCharacter(); });
+		return true;
+	}
+
+	bool navigate(const Settings& settings, std::mt19937_64& rng, Timings& timings)
+	{
+		TextEditor editor;
+		Document& doc = editor.doc;
+		load(doc, prose(rng, scaled(settings, 1000000)));
+
+		static const olc::Key keys[] = { olc::LEFT, olc::RIGHT, olc::UP, olc::DOWN, olc::HOME, olc::END };
+		for (size_t i = scaled(settings, 200000); i > 0; i--)
+		{
+			// Now and then a jump, as a find or a click would make
+			if (rng() % 64 == 0)
+			{
+				size_t offset = rng() % (doc.text.size() + 1);
+				timings.time([&] { doc.SetCaret(offset); });
+			}
+			else
+			{
+				olc::Key key = keys[rng() % 6];
+				timings.time([&] { doc.MoveCaret({ key, false, false }); });
+			}
+		}
+		return true;
+	}
+
+	bool multicaret(const Settings& settings, std::mt19937_64& rng, Timings& timings)
+	{
+		TextEditor editor;
+		Document& doc = editor.doc;
+
+		// The name turns up 10k times
+		std::string s;
+		for (size_t l = 0; l < 5000; l++) s += "\tcount = counter(count, " + std::to_string(rng() % 100) + ");\n";
+		load(doc, s);
+
+		for (size_t i = scaled(settings, 20); i > 0; i--)
+		{
+			doc.SetCaret(2);
+			timings.time([&] { doc.SelectAllMatches(); });
+			timings.time([&] { doc.ReplaceSelections("total"); });
+			timings.time([&] { doc.Undo(); });
+		}
+		return true;
+	}
+
+	std::string contents(const Document& doc)
+	{
+		std::string s(doc.text.size(), '\0');
+		doc.text.copy(0, s.size(), &s[0]);
+		return s;
+	}
+
+	bool replace(const Settings& settings, std::mt19937_64& rng, Timings& timings)
+	{
+		TextEditor editor;
+		Document& doc = editor.doc;
+
+		// Where the caret lands: before, at either end of and inside a match, for shorter and longer replacements
+		struct Case { const char* text; size_t caret; const char* needle; const char* replacement; const char* expected; size_t landed; };
+		static const Case cases[] = {
+			{ "aaXXbb", 1, "XX", "Y", "aaYbb", 1 }, { "aaXXbb", 2, "XX", "Y", "aaYbb", 2 },
+			{ "aaXXbb", 3, "XX", "Y", "aaYbb", 3 }, { "aaXXbb", 4, "XX", "Y", "aaYbb", 3 },
+			{ "aaXXbb", 5, "XX", "Y", "aaYbb", 4 }, { "aaXXbb", 3, "XX", "YYYY", "aaYYYYbb", 6 },
+			{ "aaXXbb", 1, "XX", "YYYY", "aaYYYYbb", 1 }, { "aaXXbb", 5, "XX", "YYYY", "aaYYYYbb", 7 },
+			{ "XXaXXbXX", 4, "XX", "", "ab", 1 }, { "XXaXXbXX", 7, "XX", "Y", "YaYbY", 5 }
+		};
+		bool passed = true;
+		for (const Case& c : cases)
+		{
+			load(doc, c.text);
+			doc.SetCaret(c.caret);
+			doc.ReplaceAll(c.needle, c.replacement);
+			std::string replaced = contents(doc);
+			size_t landed = doc.CaretOffset();
+			doc.Undo();
+			if (replaced != c.expected || landed != c.landed || contents(doc) != c.text)
+			{
+				std::cout << "Replacing " << c.needle << " in " << c.text << " from " << c.caret << " gave " << replaced
+					<< " with the caret at " << landed << std::endl;
+				passed = false;
+			}
+		}
+
+		// The name turns up 10k times, replaced and put back
+		std::string s;
+		for (size_t l = 0; l < 5000; l++) s += "\tcount = counter(count, " + std::to_string(rng() % 100) + ");\n";
+		load(doc, s);
+
+		for (size_t i = scaled(settings, 20); i > 0; i--)
+		{
+			doc.SetCaret(2);
+			timings.time([&] { doc.ReplaceAll("count", "total"); });
+			timings.time([&] { doc.ReplaceAll("total", "count"); });
+		}
+		if (contents(doc) != s)
+		{
+			std::cout << "Replacing a name and putting it back changed the text" << std::endl;
+			passed = false;
+		}
+		return passed;
+	}
+
+	bool frame(const Settings& settings, std::mt19937_64& rng, Timings& timings)
+	{
+		TextEditor editor;
+		Document& doc = editor.doc;
+		load(doc, source(rng, 100000), "bench.cpp");
+
+		// 240 pixels of 8 pixel lines, scrolled a line at a time with a jump every so often
+		const int visibleLines = 30;
+		for (size_t i = scaled(settings, 20000); i > 0; i--)
+		{
+			int lines = doc.caretPos.GetPage()->GetLineNum();
+			doc.caretPos.LINE = rng() % 200 == 0 ? (int)(rng() % lines) : std::min(doc.caretPos.LINE + 1, lines - 1);
+			doc.caretPos.CHAR = 0;
+			timings.time([&] { doc.LayOutFrame(visibleLines); doc.glyphs.clear(); });
+		}
+		return true;
+	}
+
+	bool openSave(const Settings& settings, std::mt19937_64& rng, Timings& timings)
+	{
+		std::string path = settings.dir + "/TextEditorBench.txt", copy = settings.dir + "/TextEditorBench.saved.txt";
+		std::string expected = prose(rng, 20 * (1 << 20) / 60);
+		std::ofstream(path, std::ios::binary).write(expected.data(), expected.size());
+
+		const std::string line = "saved over the open file\n";
+		bool passed = true;
+		for (size_t i = scaled(settings, 5); i > 0 && passed; i--)
+		{
+			TextEditor editor;
+			Document& doc = editor.doc;
+			bool ok = true;
+			timings.time([&] { ok = doc.Open(path); });
+			if (ok) timings.time([&] { ok = doc.Save(copy); });
+
+			// Ctrl + S on an edited file writes over the file its text is still mapped from
+			if (ok)
+			{
+				doc.InsertText(0, line.data(), line.size());
+				expected.insert(0, line);
+				timings.time([&] { ok = doc.Save(path); });
+			}
+			doc.autosave.stop();
+			if (!ok)
+			{
+				std::cout << "Could not open or save " << path << std::endl;
+				passed = false;
+				break;
+			}
+
+			// Both the file and the document, still reading the old mapping, have to hold the edited text
+			std::ifstream in(path, std::ios::binary);
+			std::string saved((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+			if (saved != expected || contents(doc) != expected)
+			{
+				std::cout << "Saving over " << path << " lost text" << std::endl;
+				passed = false;
+			}
+		}
+
+		for (const std::string& p : { path, copy, path + ".journal", path + ".autosave" })
+			std::remove(p.c_str());
+		return passed;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	using namespace Bench;
+	Settings settings;
+	bool valid = true;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "-workload" && i + 1 < argc) settings.workload = argv[++i];
+		else if (arg == "-scale" && i + 1 < argc) settings.scale = std::max(0.001, std::atof(argv[++i]));
+		else if (arg == "-seed" && i + 1 < argc) settings.seed = std::strtoull(argv[++i], nullptr, 10);
+		else if (arg == "-dir" && i + 1 < argc) settings.dir = argv[++i];
+		else valid = false;
+	}
+
+	typedef bool (*Workload)(const Settings&, std::mt19937_64&, Timings&);
+	const std::pair<const char*, Workload> workloads[] = {
+		{ "typing", typing }, { "random", randomEdits }, { "paste", paste }, { "backspace", backspace },
+		{ "navigate", navigate }, { "multicaret", multicaret }, { "replace", replace }, { "frame", frame }, { "openSave", openSave }
+	};
+
+	bool found = settings.workload == "all";
+	for (const auto& w : workloads) found = found || settings.workload == w.first;
+	if (!valid || !found)
+	{
+		std::cout << "Usage: TextEditorBench [-workload NAME|all] [-scale S] [-seed N] [-dir PATH]" << std::endl;
+		std::cout << "Workloads: typing, random, paste, backspace, navigate, multicaret, replace, frame, openSave" << std::endl;
+		return 1;
+	}
+
+	// A workload that checks what it did and finds it wrong fails the run, after the others have been timed
+	int failed = 0;
+	for (const auto& w : workloads)
+	{
+		if (settings.workload != "all" && settings.workload != w.first) continue;
+
+		std::mt19937_64 rng(settings.seed);
+		Timings timings;
+		if (!w.second(settings, rng, timings)) failed++;
+		timings.report(w.first);
+	}
+	if (failed) std::cout << failed << " workload" << (failed > 1 ? "s" : "") << " failed" << std::endl;
+	return failed ? 1 : 0;
+}
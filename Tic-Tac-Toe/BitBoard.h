@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace TTT {
+
+	// Cells are numbered row by row, cell (row, column) is bit 3 * row + column
+	const uint16_t FULL_BOARD = 0x1FF;
+
+	// The eight lines of three, rows then columns then diagonals
+	const uint16_t winMasks[8] = { 0x007, 0x038, 0x1C0, 0x049, 0x092, 0x124, 0x111, 0x054 };
+
+	// Players index the masks, X always moves first
+	const int PLAYER_X = 0, PLAYER_O = 1, NO_PLAYER = -1, DRAW = 2;
+
+	inline int popCount(uint32_t v)
+	{
+#if defined(_MSC_VER)
+		return (int)__popcnt(v);
+#elif defined(__GNUC__)
+		return __builtin_popcount(v);
+#else
+		int count = 0;
+		for (; v; v &= v - 1) count++;
+		return count;
+#endif
+	}
+
+	// Index of the lowest set bit, v must not be zero
+	inline int lowestBit(uint32_t v)
+	{
+#if defined(_MSC_VER)
+		unsigned long bit;
+		_BitScanForward(&bit, v);
+		return (int)bit;
+#elif defined(__GNUC__)
+		return __builtin_ctz(v);
+#else
+		int bit = 0;
+		while (!(v & 1)) { v >>= 1; bit++; }
+		return bit;
+#endif
+	}
+
+	// Index of the n-th (from zero) set bit
+	inline int nthBit(uint32_t v, int n)
+	{
+		for (; n > 0; n--) v &= v - 1;
+		return lowestBit(v);
+	}
+
+	// xorshift64*, small and fast enough for millions of random playouts, one per thread
+	struct FastRng {
+		uint64_t state;
+
+		FastRng(uint64_t seed = 0x9E3779B97F4A7C15ull) : state(seed ? seed : 1) {}
+
+		uint32_t next()
+		{
+			state ^= state >> 12;
+			state ^= state << 25;
+			state ^= state >> 27;
+			return (uint32_t)((state * 0x2545F4914F6CDD1Dull) >> 32);
+		}
+
+		// Uniform in [0, range)
+		uint32_t below(uint32_t range) { return (uint32_t)(((uint64_t)next() * range) >> 32); }
+	};
+
+	inline bool hasLine(uint16_t mask)
+	{
+		for (uint16_t win : winMasks)
+			if ((mask & win) == win) return true;
+		return false;
+	}
+
+	struct BitBoard {
+		uint16_t mask[2] = { 0, 0 };
+
+		uint16_t occupied() const { return mask[PLAYER_X] | mask[PLAYER_O]; }
+		uint16_t empty() const { return ~occupied() & FULL_BOARD; }
+
+		int at(int cell) const { return (mask[PLAYER_X] >> cell) & 1 ? PLAYER_X : (mask[PLAYER_O] >> cell) & 1 ? PLAYER_O : NO_PLAYER; }
+
+		void play(int cell, int player) { mask[player] |= 1 << cell; }
+		void clear() { mask[PLAYER_X] = mask[PLAYER_O] = 0; }
+
+		// PLAYER_X or PLAYER_O for a finished line, DRAW for a full board, otherwise NO_PLAYER
+		int winner() const
+		{
+			if (hasLine(mask[PLAYER_X])) return PLAYER_X;
+			if (hasLine(mask[PLAYER_O])) return PLAYER_O;
+			return occupied() == FULL_BOARD ? DRAW : NO_PLAYER;
+		}
+
+		// Base three index, each cell is 0 (empty), 1 (X) or 2 (O)
+		int index() const
+		{
+			int idx = 0;
+			for (int cell = 8; cell >= 0; cell--)
+				idx = idx * 3 + ((mask[PLAYER_X] >> cell) & 1) + 2 * ((mask[PLAYER_O] >> cell) & 1);
+			return idx;
+		}
+	};
+
+	// 3x3 game state with the player to move, the interface MCTS plays through
+	struct ClassicGame {
+		static const int MAX_MOVES = 9;
+
+		BitBoard board;
+		int turn = PLAYER_X;
+
+		int player() const { return turn; }
+		int result() const { return board.winner(); }
+
+		int legalMoves(uint8_t* out) const
+		{
+			int count = 0;
+			for (uint16_t free = board.empty(); free; free &= free - 1)
+				out[count++] = (uint8_t)lowestBit(free);
+			return count;
+		}
+
+		int randomMove(FastRng& rng) const
+		{
+			uint16_t free = board.empty();
+			return nthBit(free, rng.below(popCount(free)));
+		}
+
+		void play(int cell) { board.play(cell, turn); turn ^= 1; }
+	};
+
+	// Game theoretic value and best move for every one of the 3^9 board states, for either player to move
+	// (the game does not always start with X, so the masks alone do not say whose turn it is)
+	class PerfectTable {
+	public:
+		static const int STATES = 19683;
+		enum : int8_t { UNKNOWN = -2 };
+
+		// From the point of view of the player to move: 1 win, 0 draw, -1 loss
+		std::vector<int8_t> value;
+		// Cell to play, -1 when the game is already over or the state cannot be reached
+		std::vector<int8_t> bestMove;
+
+		PerfectTable() : value(2 * STATES, UNKNOWN), bestMove(2 * STATES, -1)
+		{
+			solve(BitBoard(), 0, PLAYER_X);
+			solve(BitBoard(), 0, PLAYER_O);
+		}
+
+		static const PerfectTable& get()
+		{
+			static PerfectTable table;
+			return table;
+		}
+
+		int valueOf(const BitBoard& b, int player) const { return value[player * STATES + b.index()]; }
+		int moveFor(const BitBoard& b, int player) const { return bestMove[player * STATES + b.index()]; }
+
+	private:
+		int solve(const BitBoard& b, int idx, int player)
+		{
+			int8_t& known = value[player * STATES + idx];
+			if (known != UNKNOWN)
+				return known;
+
+			// The previous player just completed a line, or the board is full
+			int result = b.winner();
+			if (result != NO_PLAYER)
+				return known = result == DRAW ? 0 : -1;
+
+			int best = -2, bestCell = -1;
+			static const int pow3[9] = { 1, 3, 9, 27, 81, 243, 729, 2187, 6561 };
+
+			for (uint16_t free = b.empty(); free; free &= free - 1)
+			{
+				int cell = lowestBit(free);
+				BitBoard next = b;
+				next.play(cell, player);
+
+				int score = -solve(next, idx + pow3[cell] * (player + 1), player ^ 1);
+				if (score > best) { best = score; bestCell = cell; }
+			}
+
+			bestMove[player * STATES + idx] = (int8_t)bestCell;
+			return known = (int8_t)best;
+		}
+	};
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <chrono>
+
+#include "BitBoard.h"
+
+namespace TTT {
+
+	// Tree parallel Monte Carlo Tree Search. Every thread walks the same tree, node statistics are atomics and a
+	// thread passing through a node adds a virtual loss so the others spread out instead of following it.
+	// Nodes come from a pool allocated once, children of a node are one contiguous block claimed with a single
+	// atomic add. Game is ClassicGame, UltimateGame or anything with the same interface.
+	template <class Game>
+	class MCTS {
+	public:
+		struct Result {
+			int move = -1;
+			uint64_t playouts = 0;
+			double seconds = 0.0;
+			float winRate = 0.0f;	// Of the chosen move, draws count half
+		};
+
+		// Exploration constant of UCT
+		float exploration = 1.4f;
+
+		MCTS(size_t poolSize = 1 << 20) : nodes(new Node[poolSize]), capacity(poolSize) {}
+
+		// Search until the time runs out or maxPlayouts is reached, then return the most visited root move
+		Result search(const Game& root, double seconds, int threadCount = 0, uint64_t maxPlayouts = 0, uint64_t seed = 1)
+		{
+			if (threadCount <= 0) threadCount = (int)std::max(1u, std::thread::hardware_concurrency());
+
+			Result result;
+			auto start = std::chrono::steady_clock::now();
+			auto deadline = start + std::chrono::microseconds((int64_t)(seconds * 1e6));
+
+			used = 1;
+			nodes[0].reset(0, root.player() ^ 1);
+			expand(0, root);
+
+			std::atomic<uint64_t> playouts{ 0 };
+			std::atomic<bool> stop{ false };
+
+			auto worker = [&](int index) {
+				FastRng rng(seed * 0x9E3779B97F4A7C15ull + index + 1);
+
+				while (!stop)
+				{
+					runPlayout(root, rng);
+
+					uint64_t done = ++playouts;
+					if ((maxPlayouts && done >= maxPlayouts) || ((done & 63) == 0 && std::chrono::steady_clock::now() >= deadline))
+						stop = true;
+				}
+			};
+
+			std::vector<std::thread> workers;
+			for (int t = 1; t < threadCount; t++) workers.emplace_back(worker, t);
+			worker(0);
+			for (std::thread& t : workers) t.join();
+
+			// Most visited child is the most trusted one
+			int first = nodes[0].firstChild, best = -1;
+			for (int i = 0; first >= 0 && i < nodes[0].childCount; i++)
+				if (best < 0 || nodes[first + i].visits > nodes[best].visits)
+					best = first + i;
+
+			if (best >= 0)
+			{
+				result.move = nodes[best].move;
+				result.winRate = nodes[best].visits ? nodes[best].score * 0.5f / nodes[best].visits : 0.0f;
+			}
+
+			result.playouts = playouts;
+			result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			return result;
+		}
+
+	private:
+		static const int32_t NO_CHILDREN = -1, EXPANDING = -2;
+		static const int VIRTUAL_LOSS = 1;
+
+		struct Node {
+			std::atomic<int32_t> visits;
+			std::atomic<int32_t> score;			// Two per win, one per draw, for the player who moved into this node
+			std::atomic<int32_t> virtualLoss;
+			std::atomic<int32_t> firstChild;
+			uint8_t childCount;
+			uint8_t move;
+			int8_t mover;
+
+			void reset(int m, int player)
+			{
+				visits.store(0, std::memory_order_relaxed);
+				score.store(0, std::memory_order_relaxed);
+				virtualLoss.store(0, std::memory_order_relaxed);
+				firstChild.store(NO_CHILDREN, std::memory_order_relaxed);
+				childCount = 0;
+				move = (uint8_t)m;
+				mover = (int8_t)player;
+			}
+		};
+
+		std::unique_ptr<Node[]> nodes;
+		size_t capacity;
+		std::atomic<size_t> used{ 0 };
+
+		// Only the thread that wins the claim expands, others keep using the node as a leaf meanwhile
+		void expand(int index, const Game& state)
+		{
+			int32_t expected = NO_CHILDREN;
+			if (!nodes[index].firstChild.compare_exchange_strong(expected, EXPANDING))
+				return;
+
+			uint8_t moves[Game::MAX_MOVES];
+			int count = state.legalMoves(moves);
+
+			size_t first = used.fetch_add(count);
+			if (count == 0 || first + count > capacity)
+			{
+				// Pool exhausted, the node stays a leaf for good
+				nodes[index].firstChild.store(count == 0 ? NO_CHILDREN : EXPANDING, std::memory_order_release);
+				return;
+			}
+
+			for (int i = 0; i < count; i++)
+				nodes[first + i].reset(moves[i], state.player());
+
+			nodes[index].childCount = (uint8_t)count;
+			nodes[index].firstChild.store((int32_t)first, std::memory_order_release);
+		}
+
+		int selectChild(int index)
+		{
+			Node& parent = nodes[index];
+			int first = parent.firstChild.load(std::memory_order_acquire);
+			float logParent = std::log((float)(parent.visits.load(std::memory_order_relaxed) + parent.virtualLoss.load(std::memory_order_relaxed) + 1));
+
+			int best = first;
+			float bestValue = -1.0f;
+
+			for (int i = first; i < first + parent.childCount; i++)
+			{
+				// Virtual losses count as visits that scored nothing
+				int32_t n = nodes[i].visits.load(std::memory_order_relaxed) + nodes[i].virtualLoss.load(std::memory_order_relaxed);
+				if (n == 0) return i;
+
+				float value = nodes[i].score.load(std::memory_order_relaxed) * 0.5f / n + exploration * std::sqrt(logParent / n);
+				if (value > bestValue) { bestValue = value; best = i; }
+			}
+
+			return best;
+		}
+
+		void runPlayout(const Game& root, FastRng& rng)
+		{
+			int path[Game::MAX_MOVES + 2];
+			int depth = 0;
+			Game state = root;
+
+			// Selection, down through expanded nodes
+			int index = 0;
+			path[depth++] = 0;
+			nodes[0].virtualLoss.fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
+
+			while (nodes[index].firstChild.load(std::memory_order_acquire) >= 0 && state.result() == NO_PLAYER)
+			{
+				index = selectChild(index);
+				state.play(nodes[index].move);
+				path[depth++] = index;
+				nodes[index].virtualLoss.fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
+			}
+
+			// Expansion happens on the second visit to keep single visit leaves out of the pool
+			if (state.result() == NO_PLAYER && nodes[index].visits.load(std::memory_order_relaxed) > 0)
+				expand(index, state);
+
+			// Random rollout
+			while (state.result() == NO_PLAYER)
+				state.play(state.randomMove(rng));
+
+			int outcome = state.result();
+
+			// Backpropagation, clearing the virtual losses on the way
+			for (int i = 0; i < depth; i++)
+			{
+				Node& node = nodes[path[i]];
+				int32_t reward = outcome == DRAW ? 1 : outcome == node.mover ? 2 : 0;
+
+				node.score.fetch_add(reward, std::memory_order_relaxed);
+				node.visits.fetch_add(1, std::memory_order_relaxed);
+				node.virtualLoss.fetch_sub(VIRTUAL_LOSS, std::memory_order_relaxed);
+			}
+		}
+	};
+}
@@ -0,0 +1,327 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+#include "BitBoard.h"
+
+namespace TTT {
+
+	// An m by n board where k in a row wins, Tic-Tac-Toe is 3,3,3 and Gomoku 15,15,5.
+	// Every run of k cells (a window) keeps a count of each player's pieces, so placing a piece only touches
+	// the windows through that cell and a win is known the moment a window count reaches k.
+	class MNKBoard {
+	public:
+		int width, height, k;
+
+		MNKBoard(int m = 3, int n = 3, int inRow = 3) : width(m), height(n), k(std::min(inRow, std::max(m, n)))
+		{
+			cells.assign(width * height, NO_PLAYER);
+			nearby.assign(width * height, 0);
+
+			// Enumerate windows along rows, columns and both diagonals
+			const int steps[4][2] = { { 1, 0 }, { 0, 1 }, { 1, 1 }, { 1, -1 } };
+			std::vector<std::vector<int>> windowsOfCell(width * height);
+
+			for (auto& step : steps)
+				for (int y = 0; y < height; y++)
+					for (int x = 0; x < width; x++)
+					{
+						int endX = x + step[0] * (k - 1), endY = y + step[1] * (k - 1);
+						if (endX < 0 || endX >= width || endY < 0 || endY >= height)
+							continue;
+
+						int window = windowTotal++;
+						for (int i = 0; i < k; i++)
+							windowsOfCell[(y + step[1] * i) * width + x + step[0] * i].push_back(window);
+					}
+
+			windowCount.assign(windowTotal * 2, 0);
+
+			// Flatten the per cell window lists
+			for (auto& list : windowsOfCell)
+			{
+				cellWindowStart.push_back((int)cellWindows.size());
+				cellWindows.insert(cellWindows.end(), list.begin(), list.end());
+			}
+			cellWindowStart.push_back((int)cellWindows.size());
+
+			// Each extra piece in an open window is worth four times the last
+			weight.assign(k + 1, 0);
+			for (int c = 1; c < k; c++) weight[c] = 1 << (2 * (c - 1));
+		}
+
+		int size() const { return width * height; }
+		int at(int cell) const { return cells[cell]; }
+		bool isEmpty(int cell) const { return cells[cell] == NO_PLAYER; }
+		int moveCount() const { return filled; }
+
+		// PLAYER_X or PLAYER_O once a line of k exists, DRAW for a full board, otherwise NO_PLAYER
+		int winner() const
+		{
+			if (lineOwner != NO_PLAYER) return lineOwner;
+			return filled == size() ? DRAW : NO_PLAYER;
+		}
+
+		void play(int cell, int player)
+		{
+			cells[cell] = (int8_t)player;
+			filled++;
+
+			for (int i = cellWindowStart[cell]; i < cellWindowStart[cell + 1]; i++)
+			{
+				int16_t* count = &windowCount[cellWindows[i] * 2];
+				balance -= windowValue(count);
+				if (++count[player] == k) lineOwner = player;
+				balance += windowValue(count);
+			}
+
+			updateNearby(cell, +1);
+		}
+
+		// Only the most recent move may be undone, a finished line can only have come from it
+		void undo(int cell, int player)
+		{
+			cells[cell] = NO_PLAYER;
+			filled--;
+			lineOwner = NO_PLAYER;
+
+			for (int i = cellWindowStart[cell]; i < cellWindowStart[cell + 1]; i++)
+			{
+				int16_t* count = &windowCount[cellWindows[i] * 2];
+				balance -= windowValue(count);
+				--count[player];
+				balance += windowValue(count);
+			}
+
+			updateNearby(cell, -1);
+		}
+
+		void clear() { *this = MNKBoard(width, height, k); }
+
+		// Heuristic value of the position for a player
+		int score(int player) const { return player == PLAYER_X ? balance : -balance; }
+
+		// Change in score for a player placing a piece here, blocking the opponent's windows counts too
+		int gain(int cell, int player) const
+		{
+			int before = 0, after = 0;
+			for (int i = cellWindowStart[cell]; i < cellWindowStart[cell + 1]; i++)
+			{
+				int16_t count[2] = { windowCount[cellWindows[i] * 2], windowCount[cellWindows[i] * 2 + 1] };
+				before += windowValue(count);
+				count[player]++;
+				after += windowValue(count);
+			}
+			return player == PLAYER_X ? after - before : before - after;
+		}
+
+		// True if placing here completes a line for the player
+		bool completesLine(int cell, int player) const
+		{
+			for (int i = cellWindowStart[cell]; i < cellWindowStart[cell + 1]; i++)
+				if (windowCount[cellWindows[i] * 2 + player] == k - 1 && windowCount[cellWindows[i] * 2 + (player ^ 1)] == 0)
+					return true;
+			return false;
+		}
+
+		// Empty cells within two cells of a piece, or the centre of an empty board
+		void candidates(std::vector<int>& out) const
+		{
+			out.clear();
+			if (filled == 0)
+			{
+				out.push_back((height / 2) * width + width / 2);
+				return;
+			}
+
+			for (int cell = 0; cell < size(); cell++)
+				if (cells[cell] == NO_PLAYER && nearby[cell] > 0)
+					out.push_back(cell);
+		}
+
+		// The 3,3,3 board as the two 9-bit masks PerfectTable uses
+		BitBoard toBitBoard() const
+		{
+			BitBoard b;
+			for (int cell = 0; cell < 9 && cell < size(); cell++)
+				if (cells[cell] != NO_PLAYER) b.play(cell, cells[cell]);
+			return b;
+		}
+
+	private:
+		std::vector<int8_t> cells;
+		std::vector<int16_t> nearby;
+		int windowTotal = 0;
+		std::vector<int16_t> windowCount;
+		std::vector<int> cellWindowStart, cellWindows;
+		std::vector<int> weight;
+		int filled = 0, lineOwner = NO_PLAYER, balance = 0;
+
+		// Value of a window for X, a window holding both players can never be won
+		int windowValue(const int16_t* count) const
+		{
+			if (count[PLAYER_X] && count[PLAYER_O]) return 0;
+			return weight[count[PLAYER_X]] - weight[count[PLAYER_O]];
+		}
+
+		void updateNearby(int cell, int delta)
+		{
+			int cx = cell % width, cy = cell / width;
+			for (int y = std::max(0, cy - 2); y <= std::min(height - 1, cy + 2); y++)
+				for (int x = std::max(0, cx - 2); x <= std::min(width - 1, cx + 2); x++)
+					nearby[y * width + x] += (int16_t)delta;
+		}
+	};
+
+	// Alpha-beta over MNKBoard. Immediate wins end a node and an opponent's open k-1 window leaves only the
+	// blocking moves (threat space pruning), the rest are ordered by gain. Root moves are shared between threads.
+	class MNKSearch {
+	public:
+		static const int WIN = 1000000;
+
+		struct Result {
+			int cell = -1, score = 0, depth = 0;
+			uint64_t nodes = 0;
+		};
+
+		int maxDepth = 64;
+		// Widest branching kept below the root on large boards, ordered by gain
+		int maxBranching = 12;
+
+		Result findBestMove(const MNKBoard& board, int player, double seconds, int threadCount = 0)
+		{
+			if (threadCount <= 0) threadCount = (int)std::max(1u, std::thread::hardware_concurrency());
+
+			deadline = std::chrono::steady_clock::now() + std::chrono::microseconds((int64_t)(seconds * 1e6));
+			stop = false;
+
+			// Each thread counts its own nodes and adds them in once it is done
+			std::atomic<uint64_t> nodes{ 0 };
+
+			Result result;
+			MNKBoard root = board;
+			std::vector<int> rootMoves = orderedMoves(root, player, false);
+			if (rootMoves.empty()) return result;
+			result.cell = rootMoves[0];
+
+			std::vector<int> rootScores(rootMoves.size());
+
+			for (int depth = 1; depth <= std::min(maxDepth, board.size() - board.moveCount()); depth++)
+			{
+				std::atomic<int> alpha{ -WIN - 1 };
+				std::atomic<size_t> next{ 1 };
+
+				// Principal move first on this thread to set a bound, then the rest in parallel
+				MNKBoard first = root;
+				first.play(rootMoves[0], player);
+				uint64_t principalNodes = 0;
+				rootScores[0] = -negamax(first, depth - 1, -WIN - 1, WIN + 1, player ^ 1, 1, principalNodes);
+				alpha = rootScores[0];
+				nodes += principalNodes;
+
+				auto worker = [&]() {
+					MNKBoard local = root;
+					uint64_t searched = 0;
+					for (size_t i = next++; i < rootMoves.size() && !stop; i = next++)
+					{
+						local.play(rootMoves[i], player);
+						int a = alpha;
+						int score = -negamax(local, depth - 1, -WIN - 1, -a, player ^ 1, 1, searched);
+						local.undo(rootMoves[i], player);
+
+						// Moves that cannot beat the bound sort behind the ones that did
+						rootScores[i] = score;
+						while (score > a && !alpha.compare_exchange_weak(a, score));
+					}
+					nodes += searched;
+				};
+
+				std::vector<std::thread> workers;
+				for (int t = 1; t < threadCount; t++) workers.emplace_back(worker);
+				worker();
+				for (std::thread& t : workers) t.join();
+
+				if (stop) break;
+
+				// Best move of the finished iteration leads the next one
+				std::vector<size_t> order(rootMoves.size());
+				for (size_t i = 0; i < order.size(); i++) order[i] = i;
+				std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return rootScores[a] > rootScores[b]; });
+
+				std::vector<int> sortedMoves;
+				for (size_t i : order) sortedMoves.push_back(rootMoves[i]);
+				rootMoves = sortedMoves;
+
+				result.cell = rootMoves[0];
+				result.score = rootScores[order[0]];
+				result.depth = depth;
+
+				if (std::abs(result.score) >= WIN - 64) break;
+			}
+
+			result.nodes = nodes;
+			return result;
+		}
+
+	private:
+		std::atomic<bool> stop{ false };
+		std::chrono::steady_clock::time_point deadline;
+
+		// Candidate moves, a single winning move or only the blocks when the opponent threatens to win
+		std::vector<int> orderedMoves(const MNKBoard& board, int player, bool prune)
+		{
+			std::vector<int> moves, blocks;
+			board.candidates(moves);
+
+			for (int cell : moves)
+			{
+				if (board.completesLine(cell, player)) return { cell };
+				if (board.completesLine(cell, player ^ 1)) blocks.push_back(cell);
+			}
+
+			if (!blocks.empty()) return blocks;
+
+			std::vector<std::pair<int, int>> scored;
+			for (int cell : moves) scored.push_back({ board.gain(cell, player), cell });
+			std::sort(scored.begin(), scored.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a.first > b.first; });
+
+			if (prune && board.size() > 25 && (int)scored.size() > maxBranching)
+				scored.resize(maxBranching);
+
+			moves.clear();
+			for (auto& s : scored) moves.push_back(s.second);
+			return moves;
+		}
+
+		// Nodes go to the calling thread's own count, which also paces its checks of the clock
+		int negamax(MNKBoard& board, int depth, int alpha, int beta, int player, int ply, uint64_t& nodes)
+		{
+			if ((++nodes & 4095) == 0 && std::chrono::steady_clock::now() > deadline) stop = true;
+			if (stop) return 0;
+
+			int result = board.winner();
+			if (result == DRAW) return 0;
+			if (result != NO_PLAYER) return -(WIN - ply);
+			if (depth == 0) return board.score(player);
+
+			int best = -WIN - 1;
+			for (int cell : orderedMoves(board, player, true))
+			{
+				board.play(cell, player);
+				int score = -negamax(board, depth - 1, -beta, -alpha, player ^ 1, ply + 1, nodes);
+				board.undo(cell, player);
+
+				if (score > best) best = score;
+				if (best > alpha) alpha = best;
+				if (alpha >= beta) break;
+			}
+
+			return best;
+		}
+	};
+}
@@ -1,64 +1,17 @@
 #include "olcPixelGameEngine.h"
+#include "olcUtility.h"
+#include "BitBoard.h"
+#include "MNKGame.h"
+#include "MCTS.h"
+#include "Ultimate.h"
 
-namespace ASSETS {
-	struct sheet {
-		std::string path;
-		olc::vi2d rowColumn, spriteSize;
-		std::vector<std::vector<olc::Decal*>> decals;
-
-		sheet(std::string _path, olc::vi2d _spriteSize, olc::vi2d _rowColumn, bool _flipRowColumn = false) {
-			path = _path;
-			spriteSize = _spriteSize;
-
-			if (_flipRowColumn) {
-				rowColumn.x = _rowColumn.y;
-				rowColumn.y = _rowColumn.x;
-			}
-			else
-				rowColumn = _rowColumn;
-		}
-
-		void loadAsset(olc::PixelGameEngine* pge) {
-			// Load and process sheet
-			olc::Sprite* sheet = new olc::Sprite(path);
-			olc::Sprite* screen = pge->GetDrawTarget();
-
-			for (int i = 0; i < rowColumn.x; i++)
-			{
-				decals.push_back(std::vector<olc::Decal*>());
-				for (int k = 0; k < rowColumn.y; k++)
-				{
-					olc::Sprite* buffer = new olc::Sprite(spriteSize.x, spriteSize.y);
-					pge->SetDrawTarget(buffer);
-
-					pge->DrawPartialSprite({ 0,0 }, sheet, olc::vi2d{ spriteSize.x * i, spriteSize.y * k }, spriteSize);
-					decals[i].push_back(new olc::Decal(buffer));
-				}
-			}
-
-			pge->SetDrawTarget(screen);
-		}
-	};
-
-	struct asset {
-		std::string path;
-		olc::vi2d spriteSize;
-		olc::Decal* decal;
-
-		asset(std::string _path, olc::vi2d _spriteSize) : path(_path), spriteSize(_spriteSize), decal(nullptr) {}
-
-		void loadAsset(olc::PixelGameEngine* pge)
-		{
-			decal = new olc::Decal(new olc::Sprite(path));
-		}
-	};
-}
+#include <future>
 
 // Override base class with your custom functionality
 class TicTacToe : public olc::PixelGameEngine
 {
 public:
-	TicTacToe()
+	TicTacToe(int m = 3, int n = 3, int k = 3, bool ultimateMode = false) : board(m, n, k), ultimate(ultimateMode)
 	{
 		sAppName = "Lets play Tic-Tac-Toe!";
 	}
@@ -76,11 +29,64 @@ public:
 
 	int xScore = 0, oScore = 0;
 	piece currentPlayer = piece::X;
-	std::vector<std::vector<piece>> board = {
-		{ piece::N, piece::N, piece::N },
-		{ piece::N, piece::N, piece::N },
-		{ piece::N, piece::N, piece::N },
-	};
+	TTT::MNKBoard board;
+	bool aiPlaysO = false;
+
+	// Ultimate Tic-Tac-Toe replaces the m,n,k board, a move is 9 * board + cell
+	bool ultimate;
+	TTT::UltimateGame ultimateGame;
+
+	// Boards other than 3,3,3 are searched on worker threads so the window keeps drawing, the future holds the move
+	TTT::MNKSearch search;
+	TTT::UltimateSolver solver;
+	std::future<int> aiMove;
+	bool discardAiMove = false;
+
+	bool isClassic() const { return board.width == 3 && board.height == 3 && board.k == 3; }
+
+	static int toPlayer(piece p) { return p == piece::X ? TTT::PLAYER_X : TTT::PLAYER_O; }
+	static piece toPiece(int player) { return player == TTT::PLAYER_X ? piece::X : player == TTT::PLAYER_O ? piece::O : piece::N; }
+
+	// Top left of a cell of the 9x9 board, small boards are two pixels apart
+	static olc::vi2d ultimateCellPos(int move)
+	{
+		int column = (move / 9) % 3 * 3 + move % 3, row = (move / 9) / 3 * 3 + (move % 9) / 3;
+		return olc::vi2d{ 15 * column + 2 * (column / 3), 15 * row + 2 * (row / 3) + 8 };
+	}
+
+	// Move under a screen position, -1 over a gap or outside the board
+	static int ultimateMoveAt(olc::vi2d pos)
+	{
+		pos.y -= 8;
+		if (pos.x < 0 || pos.y < 0) return -1;
+
+		olc::vi2d boardPos = pos / 47, inBoard = { pos.x % 47, pos.y % 47 };
+		if (boardPos.x > 2 || boardPos.y > 2 || inBoard.x >= 45 || inBoard.y >= 45) return -1;
+
+		return (boardPos.y * 3 + boardPos.x) * 9 + (inBoard.y / 15) * 3 + inBoard.x / 15;
+	}
+
+	void drawUltimateBoard()
+	{
+		uint16_t open = ultimateGame.openBoards();
+
+		for (int move = 0; move < TTT::UltimateGame::MAX_MOVES; move++)
+		{
+			olc::vi2d pos = ultimateCellPos(move);
+			// Boards the current player may play in are tinted
+			assetSheet.draw(this, pos, 2, 0, { 1.0f, 1.0f }, (open >> (move / 9)) & 1 ? olc::Pixel(255, 235, 150) : olc::WHITE);
+
+			piece pieceOnCell = toPiece(ultimateGame.at(move));
+			if (pieceOnCell != piece::N)
+				assetSheet.draw(this, pos + olc::vf2d{ 0.5f, 0.5f }, pieceOnCell == piece::X ? 0 : 1, 0, olc::vf2d{ 0.9375, 0.9375 });
+		}
+
+		// Won boards are covered by the winner's piece
+		for (int b = 0; b < 9; b++)
+			for (int player : { TTT::PLAYER_X, TTT::PLAYER_O })
+				if ((ultimateGame.won(player) >> b) & 1)
+					assetSheet.draw(this, ultimateCellPos(b * 9) + olc::vf2d{ 1.5f, 1.5f }, player, 0, olc::vf2d{ 2.625, 2.625 }, olc::Pixel(255, 255, 255, 200));
+	}
 
 	// Draw the screen
 	void drawBoard()
@@ -91,107 +97,128 @@ public:
 		DrawStringDecal(olc::vi2d{ 1,0 }, "X:" + std::to_string(xScore) + "  O:" + std::to_string(oScore), olc::BLACK, olc::vf2d{ 0.7, 1 });
 
 		// Current player
-		FillRectDecal(olc::vf2d{ 19,-0.5 }, { 8.0f, 8.0f }, olc::RED);
+		FillRectDecal(olc::vf2d{ 19,-0.5 }, { 8.0f, 8.0f }, aiPlaysO ? olc::BLUE : olc::RED);
 		DrawStringDecal(olc::vf2d{ 20.5,0.5f }, std::string(1, (char)currentPlayer), olc::WHITE, olc::vf2d{ 0.7, 0.95 });
 
+		if (ultimate)
+		{
+			drawUltimateBoard();
+			return;
+		}
+
 		// Cells
-		for (int i = 0; i < 3; i++)
-			for (int k = 0; k < 3; k++)
+		for (int i = 0; i < board.width; i++)
+			for (int k = 0; k < board.height; k++)
 			{
-				DrawDecal(olc::vi2d{ 15 * i, 15 * k + 8 }, assetSheet.decals[2][0]);
+				assetSheet.draw(this, olc::vi2d{ 15 * i, 15 * k + 8 }, 2, 0);
 
-				piece pieceOnCell = board[k][i];
+				piece pieceOnCell = toPiece(board.at(board.width * k + i));
 
 				if (pieceOnCell != piece::N)
-					DrawDecal(olc::vf2d{ 15 * i + 0.5f, 15 * k + 8 + 0.5f }, assetSheet.decals[pieceOnCell == piece::X ? 0 : 1][0], olc::vf2d{ 0.9375, 0.9375 });
+					assetSheet.draw(this, olc::vf2d{ 15 * i + 0.5f, 15 * k + 8 + 0.5f }, pieceOnCell == piece::X ? 0 : 1, 0, olc::vf2d{ 0.9375, 0.9375 });
 			}
 	}
 
-	// Check for a winner
+	// Check for a winner, the board's line counters already know
 	piece checkBoard()
 	{
-		// Horizontal
-		for (int i = 0; i < 3; i++)
-		{
-			int avg = ((int)board[i][0] + (int)board[i][1] + (int)board[i][2]) / 3;
-			
-			if (avg == (int)'X') return piece::X;
-			if (avg == (int)'O') return piece::O;
-		}
-
-		// Vertical
-		for (int i = 0; i < 3; i++)
-		{
-			int avg = ((int)board[0][i] + (int)board[1][i] + (int)board[2][i]) / 3;
-
-			if (avg == (int)'X') return piece::X;
-			if (avg == (int)'O') return piece::O;
-		}
+		int winner = ultimate ? ultimateGame.result() : board.winner();
 
-		// Diagonal
-		{
-			int avgA = ((int)board[0][0] + (int)board[1][1] + (int)board[2][2]) / 3;
-			int avgB = ((int)board[2][0] + (int)board[1][1] + (int)board[0][2]) / 3;
-
-			if (avgA == (int)'X' || avgB == (int)'X') return piece::X;
-			if (avgA == (int)'O' || avgB == (int)'O') return piece::O;
-		}
-
-		// Check if any more pieces can be placed
-		for (std::vector<piece> r : board)
-			for (piece p : r)
-				if (p == piece::N) return piece::N;
-
-		// Otherwise, the board is full
-		return piece::F;
+		if (winner == TTT::DRAW) return piece::F;
+		return toPiece(winner);
 	}
 
 	// Set all cells to none
 	void clearBoard() 
 	{
-		for (int i = 0; i < 3; i++)
-			for (int k = 0; k < 3; k++)
-				board[i][k] = piece::N;
+		board.clear();
+		ultimateGame = TTT::UltimateGame();
+		ultimateGame.setPlayer(toPlayer(currentPlayer));
+	}
+
+	// Place the current player's piece, switch player and score a finished game
+	void placePiece(int cell)
+	{
+		if (ultimate)
+			ultimateGame.play(cell);
+		else
+			board.play(cell, toPlayer(currentPlayer));
+
+		// Switch player
+		currentPlayer = currentPlayer == piece::X ? piece::O : piece::X;
+
+		// Check for a winner
+		piece winner = checkBoard();
+		if (winner != piece::N)
+		{
+			clearBoard();
+			xScore += winner == piece::X;
+			oScore += winner == piece::O;
+		}
 	}
 
 	bool OnUserCreate() override
 	{
-		assetSheet.loadAsset(this);
+		assetSheet.loadAsset();
+		TTT::PerfectTable::get();
 		return true;
 	}
 
 	bool OnUserUpdate(float fElapsedTime) override
 	{
+		// Finish any sprites decoded in the background, placeholders draw until then
+		util::AssetCache::get().update();
+
 		if (GetKey(olc::R).bPressed)
 		{
+			discardAiMove = aiMove.valid();
+			currentPlayer = piece::X;
 			clearBoard();
 			xScore = 0;
 			oScore = 0;
-			currentPlayer = piece::X;
 		}
 
-		if(GetMouse(0).bPressed)
+		// Toggle the perfect O player, its moves are a table lookup
+		if (GetKey(olc::A).bPressed)
+			aiPlaysO = !aiPlaysO;
+
+		if (aiMove.valid())
+		{
+			// Waiting on the search, a reset while it ran makes its move stale
+			if (aiMove.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			{
+				int move = aiMove.get();
+				if (!discardAiMove && move >= 0) placePiece(move);
+				discardAiMove = false;
+			}
+		}
+
+		else if (aiPlaysO && currentPlayer == piece::O)
+		{
+			if (ultimate)
+				aiMove = std::async(std::launch::async, [this, position = ultimateGame]() { return solver.solve(position, 1.0).move; });
+			else if (isClassic())
+				placePiece(TTT::PerfectTable::get().moveFor(board.toBitBoard(), TTT::PLAYER_O));
+			else
+				aiMove = std::async(std::launch::async, [this, position = board]() { return search.findBestMove(position, TTT::PLAYER_O, 1.0).cell; });
+		}
+
+		else if (ultimate && GetMouse(0).bPressed)
+		{
+			int move = ultimateMoveAt(GetMousePos());
+
+			if (move >= 0 && (ultimateGame.openBoards() >> (move / 9)) & 1 && ultimateGame.at(move) == TTT::NO_PLAYER)
+				placePiece(move);
+		}
+
+		else if(GetMouse(0).bPressed)
 		{
 			// Get the cell the mouse is over
 			olc::vi2d cellClicked = (GetMousePos() - olc::vi2d{ 0,8 }) / olc::vi2d{15, 15};
 			
-			if (board[cellClicked.y][cellClicked.x] == piece::N)
-			{
-				// Set selected cell
-				board[cellClicked.y][cellClicked.x] = currentPlayer;
-				
-				// Switch player
-				currentPlayer = currentPlayer == piece::X ? piece::O : piece::X;
-				
-				// Check for a winner
-				piece winner = checkBoard();
-				if (winner != piece::N)
-				{
-					clearBoard();
-					xScore += winner == piece::X;
-					oScore += winner == piece::O;
-				}
-			}
+			if (cellClicked.x >= 0 && cellClicked.x < board.width && cellClicked.y >= 0 && cellClicked.y < board.height &&
+				board.isEmpty(board.width * cellClicked.y + cellClicked.x))
+				placePiece(board.width * cellClicked.y + cellClicked.x);
 		}
 
 		drawBoard();
@@ -200,10 +227,60 @@ public:
 	}
 };
 
-int main()
+// Playouts per second of the MCTS player, from one thread up to maxThreads, on an empty board of each variant
+template <class Game>
+static void benchmarkMCTS(const std::string& name, int maxThreads, double seconds)
 {
-	TicTacToe demo;
-	if (demo.Construct(46, 54, 8, 8))
+	TTT::MCTS<Game> mcts(1 << 22);
+
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		typename TTT::MCTS<Game>::Result result = mcts.search(Game(), seconds, threads);
+		std::cout << name << "  threads: " << threads << "  playouts/sec: " << (uint64_t)(result.playouts / result.seconds)
+			<< "  move: " << result.move << "  win rate: " << result.winRate << std::endl;
+
+		if (threads < maxThreads && threads * 2 > maxThreads) threads = maxThreads / 2;
+	}
+}
+
+// Tic-Tac-Toe.exe [m n k], for example "15 15 5" for Gomoku
+// Tic-Tac-Toe.exe -ultimate plays Ultimate Tic-Tac-Toe, the A key hands O to the alpha-beta solver
+// Tic-Tac-Toe.exe -bench [threads] [seconds] runs the MCTS benchmark without opening a window
+int main(int argc, char* argv[])
+{
+	if (argc >= 2 && std::string(argv[1]) == "-bench")
+	{
+		int threads = argc >= 3 ? std::max(1, std::atoi(argv[2])) : (int)std::max(1u, std::thread::hardware_concurrency());
+		double seconds = argc >= 4 ? std::atof(argv[3]) : 2.0;
+
+		benchmarkMCTS<TTT::ClassicGame>("Classic ", threads, seconds);
+		benchmarkMCTS<TTT::UltimateGame>("Ultimate", threads, seconds);
+		return 0;
+	}
+
+	if (argc >= 2 && std::string(argv[1]) == "-ultimate")
+	{
+		// Three boards of three 15 pixel cells with two pixel gaps
+		TicTacToe demo(3, 3, 3, true);
+		if (demo.Construct(140, 148, 3, 3))
+			demo.Start();
+		return 0;
+	}
+
+	int m = 3, n = 3, k = 3;
+	if (argc >= 4)
+	{
+		m = std::max(1, std::atoi(argv[1]));
+		n = std::max(1, std::atoi(argv[2]));
+		k = std::max(1, std::atoi(argv[3]));
+	}
+
+	// 15 pixel cells under an 8 pixel score bar, scaled so the window stays a sensible size
+	int width = 15 * m + 1, height = 15 * n + 9;
+	int pixelSize = std::max(2, 432 / std::max(width, height));
+
+	TicTacToe demo(m, n, k);
+	if (demo.Construct(width, height, pixelSize, pixelSize))
 		demo.Start();
 	return 0;
 }
\ No newline at end of file
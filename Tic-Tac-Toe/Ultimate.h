@@ -0,0 +1,337 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+#include "BitBoard.h"
+
+namespace TTT {
+
+	// Ultimate Tic-Tac-Toe, nine 3x3 boards laid out as a 3x3 meta board. A move is 9 * board + cell and sends the
+	// opponent to the board matching the cell, unless that board is already won or full, then any board is open.
+	// Winning a small board claims that cell of the meta board, a line on the meta board wins the game.
+	//
+	// The whole state is seven 32-bit words:
+	//  word[3 * player + board / 3]  bits 9 * (board % 3) .. +8  that player's cells on the small board
+	//  word[6]  bits 0-8 boards won by X, 9-17 boards won by O, 18-26 boards won or full, 27-30 active board, 31 player to move
+	//  word[0]  bits 27-28 the outcome plus one
+	struct UltimateGame {
+		static const int MAX_MOVES = 81;
+		static const int ANY_BOARD = -1;
+
+		uint32_t word[7] = { 0, 0, 0, 0, 0, 0, uint32_t(ANY_FIELD) << 27 };
+
+		int player() const { return word[6] >> 31; }
+		int result() const { return (int)((word[0] >> 27) & 3) - 1; }
+
+		uint16_t cells(int p, int board) const { return (word[3 * p + board / 3] >> (9 * (board % 3))) & FULL_BOARD; }
+		uint16_t won(int p) const { return (word[6] >> (9 * p)) & FULL_BOARD; }
+		uint16_t closed() const { return (word[6] >> 18) & FULL_BOARD; }
+		int activeBoard() const { int a = (word[6] >> 27) & 15; return a == ANY_FIELD ? ANY_BOARD : a; }
+
+		uint16_t emptyCells(int board) const { return ~(cells(PLAYER_X, board) | cells(PLAYER_O, board)) & FULL_BOARD; }
+		uint16_t openBoards() const { return activeBoard() == ANY_BOARD ? (~closed() & FULL_BOARD) : (1 << activeBoard()); }
+
+		void setPlayer(int p) { word[6] = (word[6] & 0x7FFFFFFF) | (uint32_t(p) << 31); }
+
+		int at(int move) const
+		{
+			int board = move / 9, bit = 1 << (move % 9);
+			return cells(PLAYER_X, board) & bit ? PLAYER_X : cells(PLAYER_O, board) & bit ? PLAYER_O : NO_PLAYER;
+		}
+
+		int legalMoves(uint8_t* out) const
+		{
+			int count = 0;
+			if (result() != NO_PLAYER) return 0;
+
+			for (uint16_t boards = openBoards(); boards; boards &= boards - 1)
+			{
+				int board = lowestBit(boards);
+				for (uint16_t free = emptyCells(board); free; free &= free - 1)
+					out[count++] = (uint8_t)(board * 9 + lowestBit(free));
+			}
+
+			return count;
+		}
+
+		int randomMove(FastRng& rng) const
+		{
+			int active = activeBoard();
+			if (active != ANY_BOARD)
+			{
+				uint16_t free = emptyCells(active);
+				return active * 9 + nthBit(free, rng.below(popCount(free)));
+			}
+
+			// Pick uniformly over every empty cell of every open board
+			int counts[9], total = 0;
+			uint16_t done = closed();
+			for (int board = 0; board < 9; board++)
+				total += counts[board] = (done >> board) & 1 ? 0 : popCount(emptyCells(board));
+
+			int pick = (int)rng.below(total), board = 0;
+			while (pick >= counts[board]) pick -= counts[board++];
+			return board * 9 + nthBit(emptyCells(board), pick);
+		}
+
+		void play(int move)
+		{
+			int board = move / 9, cell = move % 9, p = player();
+			word[3 * p + board / 3] |= 1u << (9 * (board % 3) + cell);
+
+			if (hasLine(cells(p, board)))
+			{
+				word[6] |= (1u << (9 * p + board)) | (1u << (18 + board));
+				if (hasLine(won(p))) setResult(p);
+			}
+			else if (!emptyCells(board))
+				word[6] |= 1u << (18 + board);
+
+			if (result() == NO_PLAYER && closed() == FULL_BOARD)
+				setResult(DRAW);
+
+			int next = (closed() >> cell) & 1 ? ANY_FIELD : cell;
+			word[6] = (word[6] & 0x07FFFFFF) | (uint32_t(next) << 27) | (uint32_t(p ^ 1) << 31);
+		}
+
+	private:
+		static const int ANY_FIELD = 15;
+
+		void setResult(int r) { word[0] = (word[0] & ~(3u << 27)) | (uint32_t(r + 1) << 27); }
+	};
+
+	// Depth limited alpha-beta for Ultimate Tic-Tac-Toe. The transposition table stores a position once for all
+	// eight rotations and reflections of the board: the same symmetry is applied to the meta board and to every
+	// small board, and the position is keyed by the smallest hash over the eight images.
+	class UltimateSolver {
+	public:
+		static const int WIN = 10000;
+
+		struct Result {
+			int move = -1, score = 0, depth = 0;
+			uint64_t nodes = 0;
+			bool solved = false;	// score is an exact win, loss or draw rather than a heuristic
+		};
+
+		UltimateSolver(size_t tableEntries = 1 << 20)
+		{
+			size_t size = 1;
+			while (size * 2 <= tableEntries) size *= 2;
+			table.assign(size, Entry());
+
+			buildSymmetries();
+		}
+
+		Result solve(const UltimateGame& root, double seconds, int maxDepth = UltimateGame::MAX_MOVES)
+		{
+			deadline = std::chrono::steady_clock::now() + std::chrono::microseconds((int64_t)(seconds * 1e6));
+			stop = false;
+			nodes = 0;
+
+			Result result;
+			for (int depth = 1; depth <= maxDepth; depth++)
+			{
+				int move = -1;
+				int score = negamax(root, depth, -WIN - 1, WIN + 1, 0, &move);
+				if (stop) break;
+
+				result.move = move;
+				result.score = score;
+				result.depth = depth;
+				result.solved = std::abs(score) >= WIN - UltimateGame::MAX_MOVES;
+				if (result.solved) break;
+			}
+
+			result.nodes = nodes;
+			return result;
+		}
+
+		// Smallest hash over the eight symmetric images, symmetry receives the image that produced it
+		uint64_t canonicalKey(const UltimateGame& g, int& symmetry) const
+		{
+			uint64_t best = ~0ull;
+			int active = g.activeBoard();
+
+			for (int s = 0; s < 8; s++)
+			{
+				uint16_t image[2][9];
+				for (int b = 0; b < 9; b++)
+				{
+					image[PLAYER_X][cellMap[s][b]] = maskMap[s][g.cells(PLAYER_X, b)];
+					image[PLAYER_O][cellMap[s][b]] = maskMap[s][g.cells(PLAYER_O, b)];
+				}
+
+				uint64_t h = 0x9E3779B97F4A7C15ull ^ (uint64_t)g.player() ^ ((uint64_t)(active == UltimateGame::ANY_BOARD ? 9 : cellMap[s][active]) << 1);
+				for (int b = 0; b < 9; b++)
+				{
+					h = (h ^ (image[PLAYER_X][b] | (uint64_t)image[PLAYER_O][b] << 9)) * 0xFF51AFD7ED558CCDull;
+					h ^= h >> 29;
+				}
+
+				if (h < best) { best = h; symmetry = s; }
+			}
+
+			return best;
+		}
+
+	private:
+		enum : uint8_t { EXACT, LOWER, UPPER };
+
+		struct Entry {
+			uint64_t key = 0;
+			int16_t score = 0;
+			int8_t depth = -1;
+			uint8_t flag = EXACT;
+			uint8_t move = 0xFF;	// In the canonical image's frame
+		};
+
+		std::vector<Entry> table;
+		// cellMap[s][c] is where cell (or board) c lands under symmetry s, inverseMap undoes it
+		uint8_t cellMap[8][9], inverseMap[8][9];
+		uint16_t maskMap[8][512];
+
+		std::chrono::steady_clock::time_point deadline;
+		bool stop = false;
+		uint64_t nodes = 0;
+
+		void buildSymmetries()
+		{
+			for (int s = 0; s < 8; s++)
+			{
+				for (int c = 0; c < 9; c++)
+				{
+					int row = c / 3, col = c % 3;
+					// s % 4 quarter turns, then a mirror for s >= 4
+					for (int r = 0; r < s % 4; r++) { int t = row; row = col; col = 2 - t; }
+					if (s >= 4) col = 2 - col;
+
+					cellMap[s][c] = (uint8_t)(row * 3 + col);
+					inverseMap[s][row * 3 + col] = (uint8_t)c;
+				}
+
+				for (int m = 0; m < 512; m++)
+				{
+					maskMap[s][m] = 0;
+					for (int c = 0; c < 9; c++)
+						if (m & (1 << c)) maskMap[s][m] |= 1 << cellMap[s][c];
+				}
+			}
+		}
+
+		// Wins and losses are scored by their distance from the root, WIN - ply. The table keeps them as the distance
+		// from the position itself, so an entry holds for any root, in this solve or a later one.
+		static int toTable(int score, int ply)
+		{
+			if (score >= WIN - UltimateGame::MAX_MOVES) return score + ply;
+			if (score <= -(WIN - UltimateGame::MAX_MOVES)) return score - ply;
+			return score;
+		}
+
+		static int fromTable(int score, int ply)
+		{
+			if (score >= WIN - UltimateGame::MAX_MOVES) return score - ply;
+			if (score <= -(WIN - UltimateGame::MAX_MOVES)) return score + ply;
+			return score;
+		}
+
+		int mapMove(const uint8_t map[9], int move) const { return map[move / 9] * 9 + map[move % 9]; }
+
+		// Open lines on the meta board and on each open small board, from the player's point of view
+		static int evaluate(const UltimateGame& g, int p)
+		{
+			static const int metaWeight[4] = { 0, 12, 80, 0 }, localWeight[4] = { 0, 1, 5, 0 };
+			int score = 0;
+			uint16_t drawn = g.closed() & ~g.won(PLAYER_X) & ~g.won(PLAYER_O);
+
+			for (uint16_t line : winMasks)
+			{
+				uint16_t mine = g.won(p) & line, theirs = g.won(p ^ 1) & line;
+				if (line & drawn) continue;
+				if (!theirs) score += metaWeight[popCount(mine)];
+				if (!mine) score -= metaWeight[popCount(theirs)];
+			}
+
+			for (uint16_t boards = ~g.closed() & FULL_BOARD; boards; boards &= boards - 1)
+			{
+				int b = lowestBit(boards);
+				int boardWeight = b == 4 ? 2 : 1;
+				for (uint16_t line : winMasks)
+				{
+					uint16_t mine = g.cells(p, b) & line, theirs = g.cells(p ^ 1, b) & line;
+					if (!theirs) score += localWeight[popCount(mine)] * boardWeight;
+					if (!mine) score -= localWeight[popCount(theirs)] * boardWeight;
+				}
+			}
+
+			return score;
+		}
+
+		int negamax(const UltimateGame& g, int depth, int alpha, int beta, int ply, int* bestMoveOut)
+		{
+			if ((++nodes & 4095) == 0 && std::chrono::steady_clock::now() > deadline) stop = true;
+			if (stop) return 0;
+
+			int outcome = g.result();
+			if (outcome == DRAW) return 0;
+			if (outcome != NO_PLAYER) return -(WIN - ply);
+			if (depth == 0) return evaluate(g, g.player());
+
+			int symmetry = 0;
+			uint64_t key = canonicalKey(g, symmetry);
+			Entry& entry = table[key & (table.size() - 1)];
+			int ttMove = -1, alphaStart = alpha;
+
+			if (entry.key == key)
+			{
+				if (entry.move != 0xFF) ttMove = mapMove(inverseMap[symmetry], entry.move);
+
+				if (entry.depth >= depth && !bestMoveOut)
+				{
+					int score = fromTable(entry.score, ply);
+					if (entry.flag == EXACT) return score;
+					if (entry.flag == LOWER && score >= beta) return score;
+					if (entry.flag == UPPER && score <= alpha) return score;
+				}
+			}
+
+			uint8_t moves[UltimateGame::MAX_MOVES];
+			int count = g.legalMoves(moves);
+
+			// Table move first, then moves that win a small board
+			int order[UltimateGame::MAX_MOVES], keys[UltimateGame::MAX_MOVES];
+			for (int i = 0; i < count; i++)
+			{
+				int b = moves[i] / 9, p = g.player();
+				order[i] = i;
+				keys[i] = moves[i] == ttMove ? 2 : hasLine(g.cells(p, b) | (1 << (moves[i] % 9))) ? 1 : 0;
+			}
+			std::stable_sort(order, order + count, [&](int a, int b) { return keys[a] > keys[b]; });
+
+			int best = -WIN - 1, bestMove = moves[order[0]];
+			for (int i = 0; i < count; i++)
+			{
+				UltimateGame next = g;
+				next.play(moves[order[i]]);
+				int score = -negamax(next, depth - 1, -beta, -alpha, ply + 1, nullptr);
+				if (stop) return 0;
+
+				if (score > best) { best = score; bestMove = moves[order[i]]; }
+				if (best > alpha) alpha = best;
+				if (alpha >= beta) break;
+			}
+
+			entry.key = key;
+			entry.score = (int16_t)toTable(best, ply);
+			entry.depth = (int8_t)depth;
+			entry.flag = best <= alphaStart ? UPPER : best >= beta ? LOWER : EXACT;
+			entry.move = (uint8_t)mapMove(cellMap[symmetry], bestMove);
+
+			if (bestMoveOut) *bestMoveOut = bestMove;
+			return best;
+		}
+	};
+}
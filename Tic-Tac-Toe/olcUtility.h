@@ -2,15 +2,296 @@
 
 #include "olcPixelGameEngine.h"
 
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+
+// util::TextFile maps and writes files, only projects that define UTIL_TEXT_FILE before including this get it
+#if defined(UTIL_TEXT_FILE) && !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#if !defined(IOV_MAX)
+#define IOV_MAX 1024
+#endif
+#endif
+
 namespace util {
 
 	// ==== Sprite asset management ==== //
-	
-	olc::Renderable loadSprite() { return olc::Renderable(); }
 
-	olc::Renderable loadPartialSprite() { return olc::Renderable(); }
+	// Shared handle to a cached sprite and its decal, the texture is freed when the last handle is dropped.
+	// A handle from loadSpriteAsync has no decal until AssetCache::update has uploaded it.
+	typedef std::shared_ptr<olc::Renderable> RenderableRef;
+
+	// Renderables keyed by file path, loading a path that is still in use hands back the same texture.
+	// Asynchronous loads decode on worker threads, the decoded sprites are turned into decals a few at a time
+	// by update() on the main thread, which owns the graphics context.
+	class AssetCache {
+	public:
+		// Most decals created per update() call
+		int uploadsPerFrame = 2;
+
+		static AssetCache& get()
+		{
+			static AssetCache cache;
+			return cache;
+		}
+
+		~AssetCache()
+		{
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				stopping = true;
+			}
+			wake.notify_all();
+			for (std::thread& worker : workers) worker.join();
+		}
+
+		RenderableRef load(const std::string& path, bool filter = false)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+
+			RenderableRef renderable = find(path, filter);
+			if (renderable) return renderable;
+			renderable = insert(path, filter);
+			inFlight--;
+
+			// A missing file still gets a texture so drawing it stays safe
+			if (renderable->Load(path, nullptr, filter) != olc::rcode::OK)
+				renderable->Create(1, 1, filter);
+
+			return renderable;
+		}
+
+		// Returns at once, the handle's Decal() stays null until the file is decoded and uploaded
+		RenderableRef loadAsync(const std::string& path, bool filter = false)
+		{
+			std::unique_lock<std::mutex> guard(lock);
+
+			RenderableRef renderable = find(path, filter);
+			if (renderable) return renderable;
+			renderable = insert(path, filter);
+
+			if (workers.empty())
+			{
+				int count = (int)std::min(4u, std::max(1u, std::thread::hardware_concurrency()));
+				for (int i = 0; i < count; i++)
+					workers.emplace_back([this]() { decodeLoop(); });
+			}
+
+			decodeQueue.push_back({ path, filter, renderable, nullptr });
+			guard.unlock();
+			wake.notify_one();
+			return renderable;
+		}
+
+		// Call once a frame from the main thread, uploads up to uploadsPerFrame decoded sprites
+		void update()
+		{
+			for (int i = 0; i < uploadsPerFrame; i++)
+			{
+				Job job;
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					if (uploadQueue.empty()) return;
+					job = std::move(uploadQueue.front());
+					uploadQueue.pop_front();
+					inFlight--;
+				}
+
+				// Dropped before it finished loading
+				RenderableRef renderable = job.target.lock();
+				if (!renderable) continue;
+
+				if (!job.sprite)
+				{
+					renderable->Create(1, 1, job.filter);
+					continue;
+				}
+
+				// Take over the decoded pixels rather than copying them, then send them to the texture
+				renderable->Create(job.sprite->width, job.sprite->height, job.filter);
+				std::swap(renderable->Sprite()->pColData, job.sprite->pColData);
+				renderable->Decal()->Update();
+			}
+		}
+
+		// Asynchronous loads still decoding or waiting for upload
+		int pending()
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			return inFlight;
+		}
+
+		// Paths with at least one live handle
+		size_t liveCount()
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			pruneExpired();
+			return entries.size();
+		}
+
+	private:
+		struct Job {
+			std::string path;
+			bool filter = false;
+			std::weak_ptr<olc::Renderable> target;
+			std::unique_ptr<olc::Sprite> sprite;	// Null if decoding failed
+		};
+
+		std::mutex lock;
+		// Weak so the cache never keeps a texture alive by itself
+		std::unordered_map<std::string, std::weak_ptr<olc::Renderable>> entries;
+
+		std::condition_variable wake;
+		std::vector<std::thread> workers;
+		std::deque<Job> decodeQueue, uploadQueue;
+		int inFlight = 0;
+		bool stopping = false;
+
+		static std::string keyOf(const std::string& path, bool filter) { return filter ? path + "|filtered" : path; }
+
+		// Both expect the lock to be held
+		RenderableRef find(const std::string& path, bool filter)
+		{
+			auto found = entries.find(keyOf(path, filter));
+			return found != entries.end() ? found->second.lock() : nullptr;
+		}
+
+		RenderableRef insert(const std::string& path, bool filter)
+		{
+			RenderableRef renderable = std::make_shared<olc::Renderable>();
+			pruneExpired();
+			entries[keyOf(path, filter)] = renderable;
+			inFlight++;
+			return renderable;
+		}
+
+		void pruneExpired()
+		{
+			for (auto it = entries.begin(); it != entries.end();)
+				it = it->second.expired() ? entries.erase(it) : std::next(it);
+		}
+
+		void decodeLoop()
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			while (true)
+			{
+				wake.wait(guard, [this]() { return stopping || !decodeQueue.empty(); });
+				if (stopping) return;
+
+				Job job = std::move(decodeQueue.front());
+				decodeQueue.pop_front();
+				guard.unlock();
+
+				// Only decode files someone still wants, image decoding needs no graphics context
+				if (!job.target.expired())
+				{
+					job.sprite.reset(new olc::Sprite());
+					if (job.sprite->LoadFromFile(job.path) != olc::rcode::OK)
+						job.sprite.reset();
+				}
+
+				guard.lock();
+				uploadQueue.push_back(std::move(job));
+			}
+		}
+	};
+
+	inline RenderableRef loadSprite(const std::string& path, bool filter = false) { return AssetCache::get().load(path, filter); }
+
+	inline RenderableRef loadSpriteAsync(const std::string& path, bool filter = false) { return AssetCache::get().loadAsync(path, filter); }
+
+	// ==== Text ==== //
+
+	// Strings gathered into one decal instance. Every glyph becomes two triangles in one vertex list that goes
+	// to DrawPolygonDecal as a triangle list, so a frame of text binds the font texture once instead of once per
+	// glyph, and the vertex lists keep their memory from frame to frame.
+	class GlyphBatch {
+	public:
+		void clear()
+		{
+			pos.clear();
+			uv.clear();
+			tint.clear();
+		}
+
+		void addString(const olc::vf2d& at, const char* s, size_t n, const olc::Pixel& col = olc::WHITE, const olc::vf2d& scale = { 1.0f, 1.0f })
+		{
+			olc::vf2d cursor = at;
+			for (size_t i = 0; i < n; i++)
+			{
+				unsigned char c = (unsigned char)s[i];
+				if (c == '\n')
+				{
+					cursor = { at.x, cursor.y + 8.0f * scale.y };
+					continue;
+				}
+
+				// Same layout as the engine's font sheet, 16 glyphs of 8x8 per row from the space on
+				if (c > 32 && c < 128)
+				{
+					olc::vf2d source{ float((c - 32) % 16) * 8.0f, float((c - 32) / 16) * 8.0f };
+					addQuad(cursor, { 8.0f * scale.x, 8.0f * scale.y }, source, col);
+				}
+
+				cursor.x += 8.0f * scale.x;
+			}
+		}
+
+		void addString(const olc::vf2d& at, const std::string& s, const olc::Pixel& col = olc::WHITE, const olc::vf2d& scale = { 1.0f, 1.0f })
+		{
+			addString(at, s.data(), s.size(), col, scale);
+		}
+
+		size_t glyphCount() const { return pos.size() / 6; }
+
+		// Queue everything added as one decal instance, then start over
+		void draw(olc::PixelGameEngine* pge)
+		{
+			if (!fontDecal) fontDecal.reset(new olc::Decal(pge->GetFontSprite()));
+
+			if (!pos.empty())
+			{
+				// Positions arrive in pixels, the engine wants texture coordinates scaled to the font sheet
+				for (olc::vf2d& t : uv) t *= fontDecal->vUVScale;
 
-	std::vector<olc::Renderable> loadSpriteSheet() { return std::vector<olc::Renderable>(); }
+				pge->SetDecalStructure(olc::DecalStructure::LIST);
+				pge->DrawPolygonDecal(fontDecal.get(), pos, uv, tint);
+				pge->SetDecalStructure(olc::DecalStructure::FAN);
+			}
+
+			clear();
+		}
+
+	private:
+		std::vector<olc::vf2d> pos, uv;
+		std::vector<olc::Pixel> tint;
+		// A decal of the engine's own font sprite
+		std::unique_ptr<olc::Decal> fontDecal;
+
+		void addQuad(const olc::vf2d& at, const olc::vf2d& size, const olc::vf2d& source, const olc::Pixel& col)
+		{
+			olc::vf2d corners[4] = { at, { at.x, at.y + size.y }, at + size, { at.x + size.x, at.y } };
+			olc::vf2d sources[4] = { source, { source.x, source.y + 8.0f }, source + olc::vf2d{ 8.0f, 8.0f }, { source.x + 8.0f, source.y } };
+
+			for (int corner : { 0, 1, 2, 0, 2, 3 })
+			{
+				pos.push_back(corners[corner]);
+				uv.push_back(sources[corner]);
+				tint.push_back(col);
+			}
+		}
+	};
 
 	// ==== Sound asset management ==== //
 	
@@ -36,7 +317,7 @@ namespace util {
 	};
 
 	// Requires olcSound.h
-	void loadSound(SoundAsset* sound)
+	inline void loadSound(SoundAsset* sound)
 	{
 #ifdef OLC_PGEX_SOUND_H
 		// Stuff
@@ -44,7 +325,7 @@ namespace util {
 	}
 
 	// Requires olcSound.h
-	void loadSounds(std::vector<SoundAsset*>& sounds)
+	inline void loadSounds(std::vector<SoundAsset*>& sounds)
 	{
 #ifdef OLC_PGEX_SOUND_H
 		// Load each sound, enter indexs in order
@@ -53,14 +334,203 @@ namespace util {
 
 	// ==== External file management ==== //
 
+#ifdef UTIL_TEXT_FILE
+
+	// A file mapped read-only into memory. Opening costs the same for any size, pages are read in as the text
+	// is looked at, and the mapping lives as long as the object.
 	class TextFile {
-		std::string path, name;
-		std::fstream stream;
-		bool open;
+	public:
+		std::string path;
+
+		TextFile() {}
+		TextFile(const TextFile&) = delete;
+		~TextFile() { close(); }
+
+		bool open(const std::string& filePath)
+		{
+			close();
+			path = filePath;
+
+#if defined(_WIN32)
+			file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE) return false;
+
+			LARGE_INTEGER fileSize;
+			GetFileSizeEx(file, &fileSize);
+			length = (size_t)fileSize.QuadPart;
+
+			if (length > 0)
+			{
+				mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				view = mapping ? (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+				if (!view) { close(); return false; }
+			}
+			openedAs = finalPath(file);
+#else
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0) return false;
+
+			struct stat info;
+			fstat(fd, &info);
+			length = (size_t)info.st_size;
+
+			if (length > 0)
+			{
+				void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+				view = mapped == MAP_FAILED ? nullptr : (const char*)mapped;
+			}
 
-		// void openFile(){}
-		// void closeFile(){}
+			// The mapping stays valid without the descriptor
+			::close(fd);
+			if (length > 0 && !view) { length = 0; return false; }
+#endif
+			isOpen = true;
+			return true;
+		}
+
+		void close()
+		{
+#if defined(_WIN32)
+			// A save over the file while it was mapped renamed it aside, nothing needs it once the view is gone
+			std::string aside = file != INVALID_HANDLE_VALUE ? finalPath(file) : "";
+			bool replaced = !openedAs.empty() && aside != openedAs && aside.compare(0, openedAs.size() + 9, openedAs + ".replaced") == 0;
+
+			if (view) UnmapViewOfFile(view);
+			if (mapping) CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+			if (replaced) DeleteFileA(aside.c_str());
+			mapping = nullptr;
+			file = INVALID_HANDLE_VALUE;
+			openedAs.clear();
+#else
+			if (view) munmap((void*)view, length);
+#endif
+			view = nullptr;
+			length = 0;
+			isOpen = false;
+		}
+
+		bool opened() const { return isOpen; }
+		const char* data() const { return view; }
+		size_t size() const { return length; }
+
+		// Write a list of buffers in order without joining them, into a temporary file that then replaces the
+		// target, so a file the text is still mapped from is never written over while it is being read. A durable
+		// save is flushed to the disk before it replaces the target. Saving over a file that is open here works
+		// on every platform, the open file keeps its old contents.
+		static bool save(const std::string& target, const std::vector<std::pair<const char*, size_t>>& chunks, bool durable = false)
+		{
+			std::string temp = target + ".saving";
+
+#if defined(_WIN32)
+			HANDLE out = CreateFileA(temp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (out == INVALID_HANDLE_VALUE) return false;
+
+			bool ok = true;
+			for (const auto& chunk : chunks)
+				for (size_t done = 0; ok && done < chunk.second;)
+				{
+					DWORD written = 0;
+					DWORD count = (DWORD)std::min<size_t>(chunk.second - done, 1u << 30);
+					ok = WriteFile(out, chunk.first + done, count, &written, nullptr) && written > 0;
+					done += written;
+				}
+
+			if (ok && durable) ok = FlushFileBuffers(out) != 0;
+			CloseHandle(out);
+			if (ok) ok = replace(temp, target);
+			if (!ok) DeleteFileA(temp.c_str());
+			return ok;
+#else
+			int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if (fd < 0) return false;
+
+			// Gather writes, as many buffers per call as the system takes, resuming after short writes
+			bool ok = true;
+			size_t chunk = 0, skip = 0;
+			std::vector<iovec> batch;
+
+			while (ok && chunk < chunks.size())
+			{
+				batch.clear();
+				for (size_t i = chunk; i < chunks.size() && batch.size() < IOV_MAX; i++)
+				{
+					size_t from = i == chunk ? skip : 0;
+					if (chunks[i].second > from) batch.push_back({ (void*)(chunks[i].first + from), chunks[i].second - from });
+				}
+				if (batch.empty()) break;
+
+				ssize_t written = writev(fd, batch.data(), (int)batch.size());
+				ok = written > 0;
+
+				// Step past whatever was written, a short write leaves skip inside a chunk
+				size_t left = ok ? (size_t)written : 0;
+				while (chunk < chunks.size() && left >= chunks[chunk].second - skip)
+				{
+					left -= chunks[chunk].second - skip;
+					chunk++;
+					skip = 0;
+				}
+				skip += left;
+			}
+
+			if (ok && durable) ok = fsync(fd) == 0;
+			ok = ::close(fd) == 0 && ok;
+			if (ok) ok = rename(temp.c_str(), target.c_str()) == 0;
+			if (!ok) unlink(temp.c_str());
+			return ok;
+#endif
+		}
+
+	private:
+		const char* view = nullptr;
+		size_t length = 0;
+		bool isOpen = false;
+#if defined(_WIN32)
+		HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+		// Where the file was when it was opened, as the system names it
+		std::string openedAs;
+
+		static std::string finalPath(HANDLE handle)
+		{
+			char name[4 * MAX_PATH];
+			DWORD n = GetFinalPathNameByHandleA(handle, name, sizeof(name), FILE_NAME_NORMALIZED);
+			return n > 0 && n < sizeof(name) ? std::string(name, n) : std::string();
+		}
+
+		// Move a file over the target. A file that is mapped, such as the one a document was opened from, cannot
+		// be replaced, but as every TextFile shares delete it can be renamed aside first. The view keeps reading
+		// the renamed file, and close() deletes it.
+		static bool replace(const std::string& from, const std::string& target)
+		{
+			if (MoveFileExA(from.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING)) return true;
+
+			// A name still held by a file set aside earlier, and mapped or waiting to be deleted, is skipped
+			for (int i = 0; i < 64; i++)
+			{
+				std::string aside = target + ".replaced" + (i ? std::to_string(i) : "");
+				DeleteFileA(aside.c_str());
+				if (!MoveFileExA(target.c_str(), aside.c_str(), 0))
+				{
+					DWORD error = GetLastError();
+					if (error == ERROR_ALREADY_EXISTS || error == ERROR_FILE_EXISTS || error == ERROR_ACCESS_DENIED) continue;
+					return false;
+				}
+
+				if (MoveFileExA(from.c_str(), target.c_str(), 0))
+				{
+					// Goes straight away when nothing maps it after all
+					DeleteFileA(aside.c_str());
+					return true;
+				}
+				MoveFileExA(aside.c_str(), target.c_str(), 0);
+				return false;
+			}
+			return false;
+		}
+#endif
 	};
+#endif
 
 	// ==== General ==== //
 
@@ -79,4 +549,70 @@ namespace util {
 		// TODO: bounded to screen
 		bool boundedToScreen() { return false;  }
 	};
-};
\ No newline at end of file
+};
+
+// Assets shared by the PGE projects, loaded through util::AssetCache
+namespace ASSETS {
+	// Drawn in place of an asset that is still loading
+	const olc::Pixel PLACEHOLDER = olc::Pixel(200, 200, 200, 128);
+
+	struct sheet {
+		std::string path;
+		olc::vi2d rowColumn, spriteSize;
+		// The whole sheet is one shared texture, cells are drawn as parts of it
+		util::RenderableRef image;
+
+		sheet(std::string _path, olc::vi2d _spriteSize, olc::vi2d _rowColumn, bool _flipRowColumn = false) {
+			path = _path;
+			spriteSize = _spriteSize;
+
+			if (_flipRowColumn) {
+				rowColumn.x = _rowColumn.y;
+				rowColumn.y = _rowColumn.x;
+			}
+			else
+				rowColumn = _rowColumn;
+		}
+
+		// Starts loading in the background, util::AssetCache::update finishes it
+		void loadAsset() {
+			image = util::loadSpriteAsync(path);
+		}
+
+		olc::Decal* decal() const { return image ? image->Decal() : nullptr; }
+
+		// Top left of cell i across, k down, in sheet pixels
+		olc::vi2d cellSource(int i, int k) const { return olc::vi2d{ spriteSize.x * i, spriteSize.y * k }; }
+
+		void draw(olc::PixelGameEngine* pge, const olc::vf2d& pos, int i, int k, const olc::vf2d& scale = { 1.0f, 1.0f }, const olc::Pixel& tint = olc::WHITE) const
+		{
+			if (decal())
+				pge->DrawPartialDecal(pos, decal(), cellSource(i, k), spriteSize, scale, tint);
+			else
+				pge->FillRectDecal(pos, olc::vf2d(spriteSize) * scale, PLACEHOLDER);
+		}
+	};
+
+	struct asset {
+		std::string path;
+		olc::vi2d spriteSize;
+		util::RenderableRef image;
+
+		asset(std::string _path, olc::vi2d _spriteSize) : path(_path), spriteSize(_spriteSize) {}
+
+		void loadAsset()
+		{
+			image = util::loadSpriteAsync(path);
+		}
+
+		olc::Decal* decal() const { return image ? image->Decal() : nullptr; }
+
+		void draw(olc::PixelGameEngine* pge, const olc::vf2d& pos, const olc::vf2d& scale = { 1.0f, 1.0f }, const olc::Pixel& tint = olc::WHITE) const
+		{
+			if (decal())
+				pge->DrawDecal(pos, decal(), scale, tint);
+			else
+				pge->FillRectDecal(pos, olc::vf2d(spriteSize) * scale, PLACEHOLDER);
+		}
+	};
+}
\ No newline at end of file
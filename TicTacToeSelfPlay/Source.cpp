@@ -0,0 +1,219 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+
+#include "../Tic-Tac-Toe/BitBoard.h"
+#include "../Tic-Tac-Toe/MCTS.h"
+#include "../Tic-Tac-Toe/Ultimate.h"
+
+/*
+SELF-PLAY SIMULATOR
+Plays batches of Tic-Tac-Toe games between two strategies without opening a window, to measure what each
+strategy costs per game and to check the solvers statistically (the perfect player must never lose).
+Games are split evenly between threads, each thread keeps its own random number generator and tally, and
+the tallies are only added together once every thread has finished.
+
+Usage:
+	TicTacToeSelfPlay [-game classic|ultimate] [-a STRATEGY] [-b STRATEGY] [-games N] [-threads T]
+	                  [-playouts P] [-seed S] [-alternate]
+
+Strategies are random, perfect (classic only) and mcts, A plays X unless -alternate gives B every other X.
+*/
+
+namespace SelfPlay {
+
+	enum class Strategy {
+		RANDOM,
+		PERFECT,
+		MCTS,
+		INVALID
+	};
+
+	Strategy parseStrategy(const std::string& name)
+	{
+		if (name == "random") return Strategy::RANDOM;
+		if (name == "perfect") return Strategy::PERFECT;
+		if (name == "mcts") return Strategy::MCTS;
+		return Strategy::INVALID;
+	}
+
+	const char* strategyName(Strategy s)
+	{
+		return s == Strategy::RANDOM ? "random" : s == Strategy::PERFECT ? "perfect" : "mcts";
+	}
+
+	struct Settings {
+		bool ultimate = false;
+		Strategy a = Strategy::PERFECT, b = Strategy::RANDOM;
+		uint64_t games = 1000000;
+		int threads = 0;
+		int playouts = 200;			// Per MCTS move
+		uint64_t seed = 1;
+		bool alternate = false;
+	};
+
+	// One per thread, padded to its own cache line so the threads never share one while counting
+	struct alignas(64) Tally {
+		uint64_t games = 0, aWins = 0, bWins = 0, draws = 0, moves = 0;
+
+		void add(const Tally& other)
+		{
+			games += other.games;
+			aWins += other.aWins;
+			bWins += other.bWins;
+			draws += other.draws;
+			moves += other.moves;
+		}
+	};
+
+	// The perfect table only covers the 3x3 game
+	inline int perfectMove(const TTT::ClassicGame& g) { return TTT::PerfectTable::get().moveFor(g.board, g.player()); }
+	inline int perfectMove(const TTT::UltimateGame&) { return -1; }
+
+	// A strategy with the state it needs on one thread
+	template <class Game>
+	class Player {
+	public:
+		Player(Strategy s, int playoutBudget, uint64_t seed)
+			: strategy(s), playouts(playoutBudget), rng(seed),
+			// Every expansion adds at most MAX_MOVES children and there is at most one per playout
+			mcts(s == Strategy::MCTS ? (size_t)playoutBudget * Game::MAX_MOVES + 1 : 1) {}
+
+		int choose(const Game& g)
+		{
+			switch (strategy)
+			{
+			case Strategy::PERFECT:
+				return perfectMove(g);
+			case Strategy::MCTS:
+				return mcts.search(g, 1e9, 1, playouts, ((uint64_t)rng.next() << 32) | rng.next()).move;
+			default:
+				return g.randomMove(rng);
+			}
+		}
+
+	private:
+		Strategy strategy;
+		int playouts;
+		TTT::FastRng rng;
+		TTT::MCTS<Game> mcts;
+	};
+
+	template <class Game>
+	void playGames(const Settings& settings, uint64_t games, uint64_t seed, Tally& tally)
+	{
+		Player<Game> a(settings.a, settings.playouts, seed * 2 + 1), b(settings.b, settings.playouts, seed * 2 + 2);
+		Tally local;
+
+		for (uint64_t i = 0; i < games; i++)
+		{
+			// With alternation A plays O in every other game
+			bool aIsX = !settings.alternate || (i & 1) == 0;
+			Game game;
+
+			while (game.result() == TTT::NO_PLAYER)
+			{
+				bool aToMove = (game.player() == TTT::PLAYER_X) == aIsX;
+				game.play(aToMove ? a.choose(game) : b.choose(game));
+				local.moves++;
+			}
+
+			int result = game.result();
+			local.games++;
+			if (result == TTT::DRAW) local.draws++;
+			else if ((result == TTT::PLAYER_X) == aIsX) local.aWins++;
+			else local.bWins++;
+		}
+
+		tally = local;
+	}
+
+	template <class Game>
+	Tally run(const Settings& settings)
+	{
+		int threads = settings.threads;
+		if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+
+		// Build the shared table before the threads start reading it
+		if (settings.a == Strategy::PERFECT || settings.b == Strategy::PERFECT)
+			TTT::PerfectTable::get();
+
+		std::vector<Tally> tallies(threads);
+		std::vector<std::thread> workers;
+
+		for (int t = 0; t < threads; t++)
+		{
+			uint64_t games = settings.games / threads + ((uint64_t)t < settings.games % threads);
+			uint64_t seed = settings.seed * 0x9E3779B97F4A7C15ull + t;
+			workers.emplace_back(playGames<Game>, std::cref(settings), games, seed, std::ref(tallies[t]));
+		}
+
+		Tally total;
+		for (int t = 0; t < threads; t++)
+		{
+			workers[t].join();
+			total.add(tallies[t]);
+		}
+
+		return total;
+	}
+
+	void report(const Settings& settings, const Tally& total, double seconds)
+	{
+		auto percent = [&](uint64_t count) { return total.games ? 100.0 * count / total.games : 0.0; };
+
+		std::cout << std::fixed << std::setprecision(2);
+		std::cout << (settings.ultimate ? "Ultimate" : "Classic") << "  " << strategyName(settings.a) << " (A) vs "
+			<< strategyName(settings.b) << " (B)" << (settings.alternate ? ", alternating X" : ", A plays X") << std::endl;
+		std::cout << "games: " << total.games << "  moves/game: " << (total.games ? (double)total.moves / total.games : 0.0) << std::endl;
+		std::cout << "A wins: " << total.aWins << " (" << percent(total.aWins) << "%)  B wins: " << total.bWins << " ("
+			<< percent(total.bWins) << "%)  draws: " << total.draws << " (" << percent(total.draws) << "%)" << std::endl;
+		std::cout << "seconds: " << seconds << "  games/sec: " << (uint64_t)(total.games / std::max(seconds, 1e-9)) << std::endl;
+
+		// The perfect player can always force at least a draw
+		if ((settings.a == Strategy::PERFECT && total.bWins) || (settings.b == Strategy::PERFECT && total.aWins))
+			std::cout << "CHECK FAILED: the perfect player lost a game" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	using namespace SelfPlay;
+	Settings settings;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "-game" && i + 1 < argc) settings.ultimate = std::string(argv[++i]) == "ultimate";
+		else if (arg == "-a" && i + 1 < argc) settings.a = parseStrategy(argv[++i]);
+		else if (arg == "-b" && i + 1 < argc) settings.b = parseStrategy(argv[++i]);
+		else if (arg == "-games" && i + 1 < argc) settings.games = std::strtoull(argv[++i], nullptr, 10);
+		else if (arg == "-threads" && i + 1 < argc) settings.threads = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "-playouts" && i + 1 < argc) settings.playouts = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "-seed" && i + 1 < argc) settings.seed = std::strtoull(argv[++i], nullptr, 10);
+		else if (arg == "-alternate") settings.alternate = true;
+		else settings.a = Strategy::INVALID;
+	}
+
+	if (settings.a == Strategy::INVALID || settings.b == Strategy::INVALID ||
+		(settings.ultimate && (settings.a == Strategy::PERFECT || settings.b == Strategy::PERFECT)))
+	{
+		std::cout << "Usage: TicTacToeSelfPlay [-game classic|ultimate] [-a STRATEGY] [-b STRATEGY] [-games N] [-threads T]" << std::endl;
+		std::cout << "                         [-playouts P] [-seed S] [-alternate]" << std::endl;
+		std::cout << "Strategies: random, perfect (classic only), mcts" << std::endl;
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	Tally total = settings.ultimate ? run<TTT::UltimateGame>(settings) : run<TTT::ClassicGame>(settings);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	report(settings, total, seconds);
+	return 0;
+}